@@ -0,0 +1,307 @@
+// Host timings of the portable firmware code. Absolute numbers say little
+// about the ATtiny, but relative changes of the hot paths show up here long
+// before anybody flashes a station.
+#include "ask_batch_codec.hpp"
+#include "ask_capture.hpp"
+#include "ask_codec.hpp"
+#include "ask_link.hpp"
+#include "climate_decoder.hpp"
+#include "climate_protocol.hpp"
+#include "hdc1080_driver.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> randomBytes(size_t len) {
+  std::mt19937 rng(len);
+  std::vector<uint8_t> bytes(len);
+  for (uint8_t &byte : bytes)
+    byte = rng();
+  return bytes;
+}
+
+std::vector<ClimateBatchSample> randomWalk(uint8_t count) {
+  std::mt19937 rng(count);
+  std::vector<ClimateBatchSample> samples(count);
+  uint16_t temperature = 6454, humidity = 8192;
+  for (ClimateBatchSample &sample : samples) {
+    temperature += rng() % 41 - 20;
+    humidity += rng() % 81 - 40;
+    sample = {uint16_t(temperature & 0x3fff), uint16_t(humidity & 0x3fff),
+              uint8_t(7)};
+  }
+  return samples;
+}
+
+// One sample per byte and 8 per bit, a frame every 1000 bits in 0.5% flipped
+// samples
+std::vector<uint8_t> captureSamples(unsigned frames) {
+  std::mt19937 rng(frames);
+  std::bernoulli_distribution flipped(0.005);
+  std::vector<uint8_t> payload = randomBytes(CLIMATE_V2_PAYLOAD_LEN);
+  AskWaveform waveform;
+  for (unsigned i = 0; i < frames; i++) {
+    uint8_t headers[ASK_HEADER_LEN] = {0xff, uint8_t(i % 5), uint8_t(i), 0};
+    askModulate(waveform, i * 1000 + 100.3, 1, headers, payload.data(),
+                payload.size());
+  }
+  std::vector<uint8_t> samples(frames * 1000 * ASK_RX_SAMPLES_PER_BIT);
+  size_t edge = 0;
+  bool level = false;
+  for (size_t i = 0; i < samples.size(); i++) {
+    double time = double(i) / ASK_RX_SAMPLES_PER_BIT;
+    for (; edge < waveform.times.size() && waveform.times[edge] <= time; edge++)
+      level = waveform.levels[edge];
+    samples[i] = level != flipped(rng);
+  }
+  return samples;
+}
+
+// symbol_6to4() of RH_ASK before the reverse table: a search of half the
+// symbols
+uint8_t symbolSearch(uint8_t symbol) {
+  for (uint8_t i = (symbol >> 2) & 8, count = 8; count--; i++)
+    if (symbol == ask_symbols[i])
+      return i;
+  return ASK_INVALID_SYMBOL;
+}
+
+// encoded frames back to back, the symbols a decoder sees
+std::vector<uint8_t> frameSymbols(size_t count) {
+  std::vector<uint8_t> data = randomBytes(count / 2 + 1);
+  std::vector<uint8_t> symbols;
+  for (uint8_t byte : data) {
+    symbols.push_back(ask_symbols[byte >> 4]);
+    symbols.push_back(ask_symbols[byte & 0xf]);
+  }
+  symbols.resize(count);
+  return symbols;
+}
+
+} // namespace
+
+// CRC-CCITT variants over a frame: the inline formula (avr-libc assembly on
+// the AVR), the 16 entry table of ASK_CRC_NYBBLE_TABLE and slice-by-8
+static void BM_AskCrc(benchmark::State &state) {
+  std::vector<uint8_t> data = randomBytes(state.range(0));
+  for (auto _ : state) {
+    uint16_t crc = 0xffff;
+    for (uint8_t byte : data)
+      crc = askCrcUpdate(crc, byte);
+    benchmark::DoNotOptimize(crc);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_AskCrc)->Arg(5)->Arg(60);
+
+static void BM_AskCrcNybbles(benchmark::State &state) {
+  std::vector<uint8_t> data = randomBytes(state.range(0));
+  for (auto _ : state) {
+    uint16_t crc = 0xffff;
+    for (uint8_t byte : data)
+      crc = askCrcUpdateNybbles(crc, byte);
+    benchmark::DoNotOptimize(crc);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_AskCrcNybbles)->Arg(5)->Arg(60);
+
+static void BM_AskCrcSlice8(benchmark::State &state) {
+  std::vector<uint8_t> data = randomBytes(state.range(0));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(askCrc(0xffff, data.data(), data.size()));
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_AskCrcSlice8)->Arg(5)->Arg(60);
+
+// 4b6b decoding variants over the symbols of a frame: the search RH_ASK did,
+// the 64 byte table and the SSE2 batch
+static void BM_AskSymbolSearch(benchmark::State &state) {
+  std::vector<uint8_t> symbols = frameSymbols(state.range(0));
+  std::vector<uint8_t> nybbles(symbols.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < symbols.size(); i++)
+      nybbles[i] = symbolSearch(symbols[i]);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+BENCHMARK(BM_AskSymbolSearch)->Arg(14)->Arg(134);
+
+static void BM_AskSymbolTable(benchmark::State &state) {
+  std::vector<uint8_t> symbols = frameSymbols(state.range(0));
+  std::vector<uint8_t> nybbles(symbols.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < symbols.size(); i++)
+      nybbles[i] = askDecodeSymbol(symbols[i]);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+BENCHMARK(BM_AskSymbolTable)->Arg(14)->Arg(134);
+
+static void BM_AskSymbolBatch(benchmark::State &state) {
+  std::vector<uint8_t> symbols = frameSymbols(state.range(0));
+  std::vector<uint8_t> nybbles(symbols.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        askDecodeSymbols(symbols.data(), symbols.size(), nybbles.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+BENCHMARK(BM_AskSymbolBatch)->Arg(14)->Arg(134);
+
+static void BM_AskEncode(benchmark::State &state) {
+  std::vector<uint8_t> data = randomBytes(state.range(0));
+  uint8_t headers[ASK_HEADER_LEN] = {0xff, 7, 0, 0};
+  uint8_t symbols[2 * ASK_MAX_FRAME_LEN];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        askEncode(headers, data.data(), data.size(), symbols));
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_AskEncode)->Arg(5)->Arg(60);
+
+static void BM_AskDecode(benchmark::State &state) {
+  std::vector<uint8_t> data = randomBytes(state.range(0));
+  uint8_t headers[ASK_HEADER_LEN] = {0xff, 7, 0, 0};
+  uint8_t symbols[2 * ASK_MAX_FRAME_LEN];
+  uint8_t num_symbols = askEncode(headers, data.data(), data.size(), symbols);
+  uint8_t frame[ASK_MAX_FRAME_LEN];
+  for (auto _ : state) {
+    uint8_t len = askDecode(symbols, num_symbols, frame);
+    benchmark::DoNotOptimize(askCheckCrc(frame, len));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_AskDecode)->Arg(5)->Arg(60);
+
+// A climate frame through the simulated radio link at a bit rate, on a
+// reference channel with noise and edge timing errors of cheap OOK modules.
+// Besides the simulation time it reports the airtime, the delivery ratio and
+// the bit error rate the bit rate buys.
+static void BM_AskLinkSpeed(benchmark::State &state) {
+  double bit_period = askBitPeriod(state.range(0));
+  const uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, 0, 0};
+  std::vector<uint8_t> payload = randomBytes(CLIMATE_V2_PAYLOAD_LEN);
+  AskChannel channel;
+  channel.noise = 0.15;
+  channel.edge_jitter = 10e-6;
+  channel.pulse_stretch = 20e-6;
+  std::mt19937 rng(1);
+  uint64_t frames = 0, delivered = 0, bits = 0, errors = 0;
+  for (auto _ : state) {
+    AskWaveform waveform;
+    std::vector<AskFrame> sent{askModulate(waveform, 20 * bit_period,
+                                           bit_period, headers,
+                                           payload.data(), payload.size())};
+    waveform.end += 20 * bit_period;
+    AskLinkResult result = askRunLink(waveform, bit_period, channel, rng);
+    AskBitErrors frame_errors = askBitErrors(sent, result, bit_period);
+    frames++;
+    delivered += askDelivered(sent, result.frames);
+    bits += frame_errors.bits;
+    errors += frame_errors.errors;
+  }
+  state.counters["airtime_ms"] =
+      askAirtime(payload.size(), bit_period) * 1000;
+  state.counters["delivery"] = double(delivered) / frames;
+  state.counters["ber"] = bits ? double(errors) / bits : 0;
+}
+BENCHMARK(BM_AskLinkSpeed)->Arg(2000)->Arg(4000)->Arg(8000)->Arg(9600);
+
+// The receiver sample by sample, as capture_decode would without
+// askDecodeCapture()
+static void BM_AskReceiverCapture(benchmark::State &state) {
+  std::vector<uint8_t> samples = captureSamples(100);
+  for (auto _ : state) {
+    AskReceiver receiver;
+    unsigned frames = 0;
+    for (uint8_t sample : samples)
+      if (receiver.sample(sample)) {
+        frames += receiver.validate();
+        receiver.restart();
+      }
+    benchmark::DoNotOptimize(frames);
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_AskReceiverCapture);
+
+static void BM_AskSoftReceiverCapture(benchmark::State &state) {
+  std::vector<uint8_t> samples = captureSamples(100);
+  for (auto _ : state) {
+    AskSoftReceiver receiver;
+    unsigned frames = 0;
+    for (uint8_t sample : samples)
+      frames += receiver.sample(sample);
+    benchmark::DoNotOptimize(frames);
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_AskSoftReceiverCapture);
+
+static void BM_AskDecodeCapture(benchmark::State &state) {
+  std::vector<uint8_t> samples = captureSamples(100);
+  AskCaptureFormat format;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        askDecodeCapture(samples.data(), samples.size(), format,
+                         state.range(0)));
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_AskDecodeCapture)->Arg(1)->Arg(4)->UseRealTime();
+
+static void BM_ClimatePackV2(benchmark::State &state) {
+  ClimateSample sample{6454, 8192, 87};
+  uint8_t buf[CLIMATE_V2_PAYLOAD_LEN];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(climatePackV2(sample, buf));
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_ClimatePackV2);
+
+static void BM_ClimatePackBatch(benchmark::State &state) {
+  std::vector<ClimateBatchSample> samples = randomWalk(state.range(0));
+  uint8_t buf[CLIMATE_BATCH_MAX_LEN(CLIMATE_BATCH_MAX_SAMPLES)];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        climatePackBatch(samples.data(), samples.size(), 87, buf));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_ClimatePackBatch)->Arg(4)->Arg(CLIMATE_BATCH_MAX_SAMPLES);
+
+static void BM_DecodeBatchPayload(benchmark::State &state) {
+  std::vector<ClimateBatchSample> samples = randomWalk(state.range(0));
+  uint8_t buf[CLIMATE_BATCH_MAX_LEN(CLIMATE_BATCH_MAX_SAMPLES)];
+  uint8_t len = climatePackBatch(samples.data(), samples.size(), 87, buf);
+  std::vector<Measurement> measurements;
+  for (auto _ : state) {
+    measurements.clear();
+    benchmark::DoNotOptimize(decodePayload(7, buf, len, 0, measurements));
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_DecodeBatchPayload)->Arg(4)->Arg(CLIMATE_BATCH_MAX_SAMPLES);
+
+static void BM_Hdc1080Conversion(benchmark::State &state) {
+  uint16_t raw = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HDC1080I2CDriver::toCentiCelsius(raw));
+    benchmark::DoNotOptimize(HDC1080I2CDriver::toCentiPercent(raw));
+    raw += 4;
+  }
+}
+BENCHMARK(BM_Hdc1080Conversion);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,66 @@
+#include "ask_batch_codec.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// tables[k][byte]: the CRC of byte followed by k zero bytes from a zero
+// register
+struct CrcTables {
+  uint16_t tables[8][256];
+
+  CrcTables() {
+    for (unsigned byte = 0; byte < 256; byte++) {
+      tables[0][byte] = askCrcUpdate(0, byte);
+      for (unsigned k = 1; k < 8; k++)
+        tables[k][byte] = askCrcUpdate(tables[k - 1][byte], 0);
+    }
+  }
+};
+
+const CrcTables crc_tables;
+
+} // namespace
+
+uint16_t askCrc(uint16_t crc, const uint8_t *data, size_t len) {
+  const uint16_t(*t)[256] = crc_tables.tables;
+  for (; len >= 8; data += 8, len -= 8) {
+    // the register folds into the first two bytes, the CRC is linear
+    crc ^= data[0] | data[1] << 8;
+    crc = t[7][crc & 0xff] ^ t[6][crc >> 8] ^ t[5][data[2]] ^ t[4][data[3]] ^
+          t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+  }
+  for (; len; len--)
+    crc = askCrcUpdate(crc, *data++);
+  return crc;
+}
+
+size_t askDecodeSymbols(const uint8_t *symbols, size_t count,
+                        uint8_t *nybbles) {
+  size_t invalid = 0, i = 0;
+#ifdef __SSE2__
+  for (; i + 16 <= count; i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(symbols + i));
+    // a lane matches one of the 16 symbols at most and takes its nybble
+    __m128i values = _mm_setzero_si128(), found = _mm_setzero_si128();
+    for (uint8_t nybble = 0; nybble < 16; nybble++) {
+      __m128i equal = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(ask_symbols[nybble]));
+      values = _mm_or_si128(values,
+                            _mm_and_si128(equal, _mm_set1_epi8(nybble)));
+      found = _mm_or_si128(found, equal);
+    }
+    // ASK_INVALID_SYMBOL in the lanes without a match
+    values = _mm_or_si128(values, _mm_andnot_si128(found, _mm_set1_epi8(-1)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(nybbles + i), values);
+    invalid += 16 - __builtin_popcount(_mm_movemask_epi8(found));
+  }
+#endif
+  for (; i < count; i++) {
+    nybbles[i] = askDecodeSymbol(symbols[i]);
+    invalid += nybbles[i] == ASK_INVALID_SYMBOL;
+  }
+  return invalid;
+}
@@ -0,0 +1,27 @@
+#ifndef ASK_BATCH_CODEC_HPP
+#define ASK_BATCH_CODEC_HPP
+
+#include "ask_codec.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Host variants of the CRC and symbol decoding of ask_codec for decoders that
+// check many frames. Their results are bit exact with askCrcUpdate() and
+// askDecodeSymbol() of the firmware, the tables are derived from them.
+
+// CRC-CCITT over len bytes from crc on, 8 bytes per step with 8 tables
+// (slice-by-8)
+uint16_t askCrc(uint16_t crc, const uint8_t *data, size_t len);
+
+// askCheckCrc() with askCrc()
+inline bool askCheckCrcFast(const uint8_t *frame, size_t len) {
+  return askCrc(0xffff, frame, len) == ASK_CRC_RESIDUE;
+}
+
+// askDecodeSymbol() of count symbols into nybbles, 16 at a time with SSE2.
+// Returns the number of invalid symbols.
+size_t askDecodeSymbols(const uint8_t *symbols, size_t count,
+                        uint8_t *nybbles);
+
+#endif
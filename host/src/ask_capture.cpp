@@ -0,0 +1,311 @@
+#include "ask_capture.hpp"
+#include "ask_receiver.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Samples at the start of a chunk in which the previous chunk looks for the
+// same receiver state: the longest frame the receiver may be collecting after
+// a start symbol in the noise, and as much again for the PLL to lock.
+static const uint64_t SYNC_SAMPLES =
+    2 * 12 * ASK_MAX_FRAME_LEN * ASK_RX_SAMPLES_PER_BIT;
+
+// Shortest chunk: the previous chunk needs the receiver states of the whole
+// sync window, and one frame more in which it finishes a frame in progress
+// before the hand-over.
+static const uint64_t MIN_CHUNK_SAMPLES =
+    SYNC_SAMPLES +
+    (ASK_PREAMBLE_LEN + 2 * ASK_MAX_FRAME_LEN) * 6 * ASK_RX_SAMPLES_PER_BIT;
+
+// samples a chunk packs at a time, fits the L1 cache
+static const size_t BLOCK_SAMPLES = 8 * 4096;
+
+void askPackSamples(const uint8_t *samples, size_t count, uint8_t channel,
+                    uint8_t *bits) {
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i mask = _mm_set1_epi8(1 << channel);
+  for (; i + 16 <= count; i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+    // 0xff where the channel bit is set, the sign bits make the mask
+    __m128i high = _mm_cmpeq_epi8(_mm_and_si128(chunk, mask), mask);
+    uint16_t packed = _mm_movemask_epi8(high);
+    bits[i / 8] = packed;
+    bits[i / 8 + 1] = packed >> 8;
+  }
+#endif
+  for (; i < count; i += 8) {
+    uint8_t packed = 0;
+    for (size_t j = 0; j < 8 && i + j < count; j++)
+      packed |= ((samples[i + j] >> channel) & 1) << j;
+    bits[i / 8] = packed;
+  }
+}
+
+namespace {
+
+struct PllStep {
+  uint8_t ramp;
+  bool last;
+  bool wrap;
+  uint8_t wrap_sample;
+  uint8_t ones_before;
+  uint8_t ones_after;
+};
+
+// The receiver PLL over 4 samples: ramp and last sample after them, whether
+// the ramp wrapped (a bit ended) and after which sample, and the high samples
+// up to and including that one and after it. AskReceiver::sample() without
+// the frame handling.
+PllStep pllStep(uint8_t ramp, bool last, uint8_t samples) {
+  PllStep step = {ramp, last, false, 0, 0, 0};
+  for (uint8_t i = 0; i < 4; i++) {
+    bool rx = samples & (1 << i);
+    (step.wrap ? step.ones_after : step.ones_before) += rx;
+    if (rx != step.last) {
+      step.ramp += step.ramp < ASK_RX_RAMP_TRANSITION
+                       ? ASK_RX_RAMP_INC_RETARD
+                       : ASK_RX_RAMP_INC_ADVANCE;
+      step.last = rx;
+    } else {
+      step.ramp += ASK_RX_RAMP_INC;
+    }
+    if (step.ramp >= ASK_RX_RAMP_LEN) {
+      // 4 samples advance the ramp by at most 4 * 29 < 160, one wrap at most
+      step.ramp -= ASK_RX_RAMP_LEN;
+      step.wrap = true;
+      step.wrap_sample = i;
+    }
+  }
+  return step;
+}
+
+// pllStep() for every ramp, last sample and 4 samples, packed into 32 bits:
+// ramp, last, wrap, wrap sample, ones before and after the wrap
+struct PllTable {
+  uint32_t steps[ASK_RX_RAMP_LEN * 2 * 16];
+
+  PllTable() {
+    for (unsigned ramp = 0; ramp < ASK_RX_RAMP_LEN; ramp++)
+      for (unsigned last = 0; last < 2; last++)
+        for (unsigned samples = 0; samples < 16; samples++) {
+          PllStep step = pllStep(ramp, last, samples);
+          steps[index(ramp, last, samples)] =
+              step.ramp | step.last << 8 | step.wrap << 9 |
+              step.wrap_sample << 10 | step.ones_before << 12 |
+              step.ones_after << 16;
+        }
+  }
+
+  static unsigned index(unsigned ramp, unsigned last, unsigned samples) {
+    return (ramp << 5) | (last << 4) | samples;
+  }
+};
+
+const PllTable pll_table;
+
+// The receiver over one chunk of the decimated samples. It starts without
+// knowing the receiver state at its begin, so the previous chunk continues
+// past that until both receivers agree (synced()) and hands over there. Frames
+// belong to the chunk their start symbol is in, none is lost or counted twice
+// at the border.
+class ChunkDecoder {
+public:
+  ChunkDecoder(const uint8_t *data, uint64_t samples,
+               const AskCaptureFormat &format, uint64_t begin)
+      : _data(data), _samples(samples), _format(format), _begin(begin),
+        _sample(begin), _end(begin) {}
+
+  // Decodes up to end, remembering the states in the first SYNC_SAMPLES
+  void decode(uint64_t end) {
+    run(end, [this](uint64_t sample) {
+      if (sample - _begin <= SYNC_SAMPLES)
+        _states.push_back(state());
+      return false;
+    });
+    _end = _sample;
+  }
+
+  // Continues up to the first sample at which the receiver agrees with the
+  // state next had there, or past the states of next, and finishes a frame
+  // in progress
+  void sync(const ChunkDecoder &next) {
+    run(next._begin + 8 * next._states.size(), [&](uint64_t sample) {
+      return sample > next._begin &&
+             synced(state(), next._states[(sample - next._begin) / 8 - 1]);
+    });
+    run(_samples, [this](uint64_t) { return !_active; });
+    _end = _sample;
+  }
+
+  uint64_t end() const { return _end; }
+
+  // Adds the frames whose start symbol came at or after from to result
+  void collect(uint64_t from, AskCaptureResult &result) const {
+    for (const Frame &frame : _frames) {
+      if (frame.start < from)
+        continue;
+      if (!frame.bytes.empty())
+        result.frames.push_back({frame.sample, frame.bytes});
+      else if (frame.bad_crc)
+        result.bad_crc++;
+      else
+        result.bad_count++;
+    }
+  }
+
+private:
+  struct Frame {
+    uint64_t start;  // sample of the start symbol
+    uint64_t sample; // sample at which the frame was complete
+    std::vector<uint8_t> bytes; // empty if dropped for its count or CRC
+    bool bad_crc;
+  };
+
+  // Decodes whole packed bytes from _sample on up to end, or until stop(the
+  // sample after the byte) returns true
+  template <typename Stop> void run(uint64_t end, Stop stop) {
+    end = std::min(end, _samples);
+    std::vector<uint8_t> block(BLOCK_SAMPLES / 8);
+    while (_sample < end) {
+      size_t count = std::min<uint64_t>(BLOCK_SAMPLES, end - _sample);
+      const uint8_t *bits = pack(_sample, count, block.data());
+      for (size_t i = 0; i < count; i += 8) {
+        uint8_t byte = bits[i / 8];
+        step(_sample + i, byte & 0x0f);
+        step(_sample + i + 4, byte >> 4);
+        if (stop(_sample + i + 8)) {
+          _sample += i + 8;
+          return;
+        }
+      }
+      _sample += count;
+    }
+  }
+
+  // PLL ramp, last sample and the last 12 bits, 0 while collecting a frame
+  uint32_t state() const {
+    if (_active)
+      return 0;
+    return 1 | _ramp << 1 | _last << 9 | _bits << 10;
+  }
+
+  // Both receivers outside of a frame with the same bits, and their PLLs at
+  // most a sample apart. Two locked PLLs see the same transitions and
+  // correct alike, so a few ramp steps between them may stay for ever.
+  static bool synced(uint32_t a, uint32_t b) {
+    if (!(a & b & 1) || a >> 9 != b >> 9)
+      return false;
+    int ramps = std::abs(int(a >> 1 & 0xff) - int(b >> 1 & 0xff));
+    return std::min(ramps, ASK_RX_RAMP_LEN - ramps) <= ASK_RX_RAMP_INC;
+  }
+
+  // packed samples from sample on, in block unless the capture is packed
+  const uint8_t *pack(uint64_t sample, size_t count, uint8_t *block) {
+    if (_format.packed)
+      return _data + sample / 8;
+    if (_format.decimation == 1) {
+      askPackSamples(_data + sample, count, _format.channel, block);
+      return block;
+    }
+    std::fill(block, block + (count + 7) / 8, 0);
+    const uint8_t *samples = _data + sample * _format.decimation;
+    for (size_t i = 0; i < count; i++)
+      block[i / 8] |= ((samples[i * _format.decimation] >> _format.channel) & 1)
+                      << (i % 8);
+    return block;
+  }
+
+  void step(uint64_t sample, uint8_t samples) {
+    uint32_t step = pll_table.steps[PllTable::index(_ramp, _last, samples)];
+    _ramp = step & 0xff;
+    _last = step >> 8 & 1;
+    _integrator += step >> 12 & 0x7;
+    if (step >> 9 & 1) {
+      bit(sample + (step >> 10 & 0x3), _integrator >= ASK_RX_ONE_THRESHOLD);
+      _integrator = step >> 16 & 0x7;
+    }
+  }
+
+  void bit(uint64_t sample, bool one) {
+    _bits = (_bits >> 1 | one << 11) & 0xfff;
+    if (_receiver.bit(one)) {
+      _active = false;
+      Frame frame = {_start, sample, {}, !_receiver.validate()};
+      if (!frame.bad_crc)
+        frame.bytes.assign(_receiver.frame(),
+                           _receiver.frame() + _receiver.frameLen());
+      _frames.push_back(std::move(frame));
+      _receiver.restart();
+    } else if (_receiver.active() != _active) {
+      _active = !_active;
+      if (_active)
+        _start = sample;
+      else
+        _frames.push_back({_start, sample, {}, false});
+    }
+  }
+
+  const uint8_t *_data;
+  uint64_t _samples;
+  AskCaptureFormat _format;
+  uint64_t _begin;
+  uint64_t _sample; // next sample to decode
+  uint64_t _end;    // where the next chunk takes over
+  std::vector<uint32_t> _states;
+
+  uint8_t _ramp = 0;
+  bool _last = false;
+  uint8_t _integrator = 0;
+  uint32_t _bits = 0;
+  AskReceiver _receiver;
+  bool _active = false;
+  uint64_t _start = 0;
+  std::vector<Frame> _frames;
+};
+
+} // namespace
+
+AskCaptureResult askDecodeCapture(const uint8_t *data, size_t size,
+                                  const AskCaptureFormat &format,
+                                  unsigned threads) {
+  uint64_t samples = format.packed ? uint64_t(size) * 8
+                                   : size / std::max(format.decimation, 1u);
+  samples &= ~uint64_t(7);
+  threads = std::max<uint64_t>(
+      1, std::min<uint64_t>(threads, samples / MIN_CHUNK_SAMPLES));
+  // chunks of whole packed bytes
+  uint64_t chunk = (samples / threads + 7) & ~uint64_t(7);
+  std::vector<ChunkDecoder> chunks;
+  for (unsigned i = 0; i < threads; i++)
+    chunks.emplace_back(data, samples, format, std::min(samples, i * chunk));
+
+  // every chunk up to the next one, then up to where it meets the next
+  auto parallel = [&](auto work) {
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++)
+      workers.emplace_back(work, i);
+    for (std::thread &worker : workers)
+      worker.join();
+  };
+  parallel([&](unsigned i) {
+    chunks[i].decode(i + 1 < threads ? (i + 1) * chunk : samples);
+  });
+  parallel([&](unsigned i) {
+    if (i + 1 < threads)
+      chunks[i].sync(chunks[i + 1]);
+  });
+
+  AskCaptureResult result;
+  for (unsigned i = 0; i < threads; i++)
+    chunks[i].collect(i ? chunks[i - 1].end() : 0, result);
+  result.samples = samples;
+  result.threads = threads;
+  return result;
+}
@@ -0,0 +1,62 @@
+#ifndef ASK_CAPTURE_HPP
+#define ASK_CAPTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Offline RH_ASK decoder for raw sample captures of the receiver output. On
+// one thread it gives the frames of AskReceiver::sample() with each frame
+// taken out right away, but it is built for throughput:
+// - the samples are packed to one bit each, 16 per SSE2 instruction
+// - the PLL and integrator step 4 samples per table lookup
+// - the capture is split into chunks decoded by one thread each. Each chunk
+//   continues into the next until both receivers agree on the bits outside of
+//   a frame and hands over there. The PLL of the next chunk may be locked a
+//   few ramp steps apart from a single pass, frames near the noise limit can
+//   come out differently, but none is lost or found twice at a border.
+
+// How the receiver output is stored
+struct AskCaptureFormat {
+  // 8 samples per byte, LSB first. Otherwise one sample per byte.
+  bool packed = false;
+  // bit of the sample bytes with the receiver output, as logic analysers
+  // store one channel per bit
+  uint8_t channel = 0;
+  // every n-th sample is used, for captures at n times 8 samples per bit
+  unsigned decimation = 1;
+};
+
+struct AskCaptureFrame {
+  // sample (after decimation) at which the receiver completed the frame
+  uint64_t sample;
+  // count byte, headers, payload and CRC
+  std::vector<uint8_t> bytes;
+};
+
+struct AskCaptureResult {
+  // frames with a good CRC, in order
+  std::vector<AskCaptureFrame> frames;
+  // frames dropped for their count byte or CRC, validateRxBuf() counts both
+  // as bad
+  uint64_t bad_count = 0;
+  uint64_t bad_crc = 0;
+  // samples decoded, after decimation
+  uint64_t samples = 0;
+  // threads the capture was decoded on
+  unsigned threads = 0;
+};
+
+// Packs count samples (one per byte, the receiver output in bit channel) to 8
+// per byte, LSB first. bits needs (count + 7) / 8 bytes.
+void askPackSamples(const uint8_t *samples, size_t count, uint8_t channel,
+                    uint8_t *bits);
+
+// Decodes a capture of size bytes with up to threads threads, fewer if the
+// chunks would get too short to hand over. Trailing samples short of a packed
+// byte are ignored.
+AskCaptureResult askDecodeCapture(const uint8_t *data, size_t size,
+                                  const AskCaptureFormat &format,
+                                  unsigned threads);
+
+#endif
@@ -0,0 +1,124 @@
+#include "ask_edge_decoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// a longer run only clears the 12 bit shift register of the receiver
+static const double MAX_RUN_BITS = 12;
+
+// Bits before the end of the start symbol whose rising edges estimate the bit
+// period: the preamble without its first 12 bits, in which the AGC of the
+// receiver settles, and the start symbol
+static const uint64_t PREAMBLE_FIT_BITS = 6 * ASK_PREAMBLE_LEN - 12;
+
+// largest bit rate error fitted, beyond that the RC oscillator is broken
+static const double MAX_RATE_OFFSET = 0.15;
+
+bool AskEdgeDecoder::edge(double time, bool level) {
+  if (level == _level)
+    return false; // the end of a dropped glitch, or a lost event
+  double width = time - _runStart;
+  if (_pending && width < _bitPeriod / 4) {
+    // The run that just ended is a glitch, the one before it continues. It
+    // is shorter by the glitch, which keeps a glitch right after an edge from
+    // moving that edge.
+    _glitches++;
+    _level = _pendingLevel;
+    _runStart = _pendingStart + width;
+    _pending = false;
+    return false;
+  }
+
+  bool good = _pending && push(_pendingLevel, _pendingStart, _runStart);
+  _pending = true;
+  _pendingLevel = _level;
+  _pendingStart = _runStart;
+  _level = level;
+  _runStart = time;
+  return good;
+}
+
+bool AskEdgeDecoder::idle(double time) {
+  bool good = _pending && push(_pendingLevel, _pendingStart, _runStart);
+  _pending = false;
+  if (!_receiver.active())
+    return good;
+
+  // the whole bits of the current run so far, the rest stays with the run
+  double bits = std::floor((time - _runStart) / _period);
+  if (bits < 1)
+    return good;
+  double end = _runStart + bits * _period;
+  good = push(_level, _runStart, end) || good;
+  _runStart = end;
+  return good;
+}
+
+bool AskEdgeDecoder::push(bool level, double start, double end) {
+  if (level && _receiver.active()) {
+    fit({_bits, start});
+  } else if (level) {
+    // what may be the preamble so far sets the bit period of the start symbol
+    _preamble.push_back({_bits, start});
+    while (_preamble.front().bit + PREAMBLE_FIT_BITS < _bits)
+      _preamble.pop_front();
+    _edges = 0;
+    _period = _bitPeriod;
+    for (const Edge &edge : _preamble)
+      fit(edge);
+  }
+
+  double bits = std::min(std::round((end - start) / _period), MAX_RUN_BITS);
+  bool good = false;
+  for (int i = 0; i < bits; i++) {
+    bool active = _receiver.active();
+    bool complete = _receiver.bit(level);
+    _bits++;
+    if (!active && _receiver.active()) {
+      // start symbol, the frame begins with the bit period of its preamble
+      _edges = 0;
+      _period = _bitPeriod;
+      for (const Edge &edge : _preamble)
+        if (edge.bit + PREAMBLE_FIT_BITS >= _bits)
+          fit(edge);
+      _preamble.clear();
+      continue;
+    }
+    if (active && !complete && !_receiver.active()) {
+      _period = _bitPeriod; // bad count byte
+      continue;
+    }
+    if (!complete)
+      continue;
+    if (_receiver.validate()) {
+      _frameLen = _receiver.frameLen();
+      std::memcpy(_frame, _receiver.frame(), _frameLen);
+      _frameTime = start + (i + 1) * _period;
+      _frameRateOffset = _bitPeriod / _period - 1;
+      good = true;
+    }
+    _receiver.restart();
+    _period = _bitPeriod;
+  }
+  return good;
+}
+
+void AskEdgeDecoder::fit(const Edge &edge) {
+  if (!_edges++) {
+    _first = edge;
+    _sumBits = _sumTimes = _sumBits2 = _sumBitsTimes = 0;
+  }
+  double bits = edge.bit - _first.bit;
+  double time = edge.time - _first.time;
+  _sumBits += bits;
+  _sumTimes += time;
+  _sumBits2 += bits * bits;
+  _sumBitsTimes += bits * time;
+  double spread = _edges * _sumBits2 - _sumBits * _sumBits;
+  if (_edges < 4 || spread <= 0)
+    return;
+  double period = (_edges * _sumBitsTimes - _sumBits * _sumTimes) / spread;
+  _period = std::min(std::max(period, _bitPeriod / (1 + MAX_RATE_OFFSET)),
+                     _bitPeriod / (1 - MAX_RATE_OFFSET));
+}
@@ -0,0 +1,95 @@
+#ifndef ASK_EDGE_DECODER_HPP
+#define ASK_EDGE_DECODER_HPP
+
+#include "ask_receiver.hpp"
+
+#include <cstdint>
+#include <deque>
+
+// RH_ASK demodulator for timestamped edges of the receiver output, as a Linux
+// GPIO character device reports them, instead of sampling it 8 times per bit.
+// Every edge resynchronises the bit clock: the time between two edges rounded
+// to bit periods is the number of bits of the level in between. Pulses
+// shorter than a quarter bit are glitches and merge into the level around them,
+// which then lasts shorter by the glitch.
+// The bits go into AskReceiver::bit(), so start symbol, 4b6b and CRC are
+// those of RH_ASK.
+//
+// The stations clock their bits from the RC oscillator of the ATtiny, which
+// drifts by several percent with temperature. With the start symbol the bit
+// period of the frame is fitted to the rising edges of the preamble, and
+// refitted with every rising edge of the frame, so the runs of up to 4 equal
+// bits inside of it round to the right number of bits. Rising edges only, the
+// falling ones move with the pulse stretch of the receiver.
+//
+// Runs are decided one edge late to catch glitches. A frame whose last bits
+// are low only ends with the next edge, or with idle() once the line stayed
+// quiet long enough.
+class AskEdgeDecoder {
+public:
+  explicit AskEdgeDecoder(double bit_period) : _bitPeriod(bit_period) {}
+
+  // The receiver output changed to level at time (s, ascending). Returns true
+  // when a frame with a good CRC came in.
+  bool edge(double time, bool level);
+
+  // No edge came until time. Completes a frame the receiver is collecting,
+  // returns true like edge().
+  bool idle(double time);
+
+  // true while collecting a frame, idle() is only needed then
+  bool active() const { return _pending || _receiver.active(); }
+
+  // The last good frame: count byte, headers, payload and CRC, and when its
+  // last bit ended
+  const uint8_t *frame() const { return _frame; }
+  uint8_t frameLen() const { return _frameLen; }
+  double frameTime() const { return _frameTime; }
+
+  // bit rate of the last good frame relative to bit_period, 0.02 for a
+  // transmitter 2% fast
+  double frameRateOffset() const { return _frameRateOffset; }
+
+  uint16_t rxGood() const { return _receiver.rxGood(); }
+  uint16_t rxBad() const { return _receiver.rxBad(); }
+  // pulses dropped as glitches
+  uint32_t glitches() const { return _glitches; }
+
+private:
+  // a rising edge and the number of bits decided before it
+  struct Edge {
+    uint64_t bit;
+    double time;
+  };
+
+  bool push(bool level, double start, double end);
+  void fit(const Edge &edge);
+
+  AskReceiver _receiver;
+  double _bitPeriod;
+  // bit period of the current frame, _bitPeriod between frames
+  double _period = _bitPeriod;
+  uint64_t _bits = 0;
+  // rising edges up to the start symbol
+  std::deque<Edge> _preamble;
+  // least squares sums over the rising edges of the frame, relative to its
+  // first one
+  Edge _first = {};
+  double _sumBits = 0, _sumTimes = 0, _sumBits2 = 0, _sumBitsTimes = 0;
+  unsigned _edges = 0;
+  double _frameRateOffset = 0;
+  // current level since _runStart
+  bool _level = false;
+  double _runStart = 0;
+  // the previous run, not yet decided
+  bool _pending = false;
+  bool _pendingLevel = false;
+  double _pendingStart = 0;
+  uint32_t _glitches = 0;
+
+  uint8_t _frame[ASK_MAX_FRAME_LEN];
+  uint8_t _frameLen = 0;
+  double _frameTime = 0;
+};
+
+#endif
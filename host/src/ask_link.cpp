@@ -0,0 +1,206 @@
+#include "ask_link.hpp"
+
+#include "ask_transmitter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Impairments starting at random (Poisson) times that last for length, or a
+// random time of mean length. They do not overlap.
+class Bursts {
+public:
+  Bursts(double rate, double length, bool random_length)
+      : _rate(rate), _length(length), _random_length(random_length) {}
+
+  // true while a burst is on at time t, t must not decrease between calls
+  bool active(double t, std::mt19937 &rng) {
+    if (_rate <= 0 || _length <= 0)
+      return false;
+    while (t >= _end) {
+      _start = _end + std::exponential_distribution<double>(_rate)(rng);
+      _end = _start + (_random_length ? std::exponential_distribution<double>(
+                                            1 / _length)(rng)
+                                      : _length);
+    }
+    return t >= _start;
+  }
+
+private:
+  double _rate;
+  double _length;
+  bool _random_length;
+  double _start = 0;
+  double _end = 0;
+};
+
+} // namespace
+
+double askBitPeriod(uint16_t speed) {
+  uint32_t bit_cycles = F_CPU / speed;
+  uint8_t cs = ask_timer::prescaler(bit_cycles);
+  if (!cs)
+    return 1.0 / speed;
+  return double(ask_timer::bitTicks(bit_cycles, cs) << (cs - 1)) / F_CPU;
+}
+
+double askAirtime(uint8_t len, double bit_period) {
+  return 6 * (ASK_PREAMBLE_LEN + 2 * (len + ASK_FRAME_OVERHEAD)) * bit_period;
+}
+
+AskFrame askModulate(AskWaveform &waveform, double start, double bit_period,
+                     const uint8_t *headers, const uint8_t *data, uint8_t len) {
+  uint8_t symbols[ASK_PREAMBLE_LEN + 2 * ASK_MAX_FRAME_LEN];
+  std::copy(ask_preamble, ask_preamble + ASK_PREAMBLE_LEN, symbols);
+  uint8_t num_symbols =
+      ASK_PREAMBLE_LEN +
+      askEncode(headers, data, len, symbols + ASK_PREAMBLE_LEN);
+
+  // symbols LSB first, one bit period each
+  bool level = !waveform.levels.empty() && waveform.levels.back();
+  auto write = [&](double t, bool next) {
+    if (next != level) {
+      waveform.times.push_back(t);
+      waveform.levels.push_back(next);
+      level = next;
+    }
+  };
+  double t = start;
+  for (uint8_t i = 0; i < num_symbols; i++)
+    for (uint8_t bit = 0; bit < 6; bit++, t += bit_period)
+      write(t, symbols[i] & (1 << bit));
+  AskFrame frame = {t, std::vector<uint8_t>(ASK_MAX_FRAME_LEN)};
+  write(t, false);
+  waveform.end = std::max(waveform.end, t + bit_period);
+
+  frame.bytes.resize(askDecode(symbols + ASK_PREAMBLE_LEN,
+                               num_symbols - ASK_PREAMBLE_LEN,
+                               frame.bytes.data()));
+  return frame;
+}
+
+AskLinkResult askRunLink(const AskWaveform &waveform, double bit_period,
+                         const AskChannel &channel, std::mt19937 &rng,
+                         const AskSoftOptions *soft) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::normal_distribution<double> gaussian(0, std::max(channel.noise, 1e-9));
+  Bursts flips(channel.flip_rate / bit_period, bit_period, false);
+  Bursts dropouts(channel.dropout_rate, channel.dropout_length, true);
+
+  // Move the edges, a pulse shorter than the shift between its edges
+  // disappears. The levels alternate, so dropping both edges keeps them right.
+  std::vector<double> times;
+  std::vector<uint8_t> levels;
+  std::normal_distribution<double> edge_jitter(
+      0, std::max(channel.edge_jitter, 1e-12));
+  for (size_t i = 0; i < waveform.times.size(); i++) {
+    double t = waveform.times[i];
+    if (channel.edge_jitter > 0)
+      t += edge_jitter(rng);
+    if (!waveform.levels[i])
+      t += channel.pulse_stretch;
+    if (!times.empty() && t <= times.back()) {
+      times.pop_back();
+      levels.pop_back();
+      continue;
+    }
+    times.push_back(t);
+    levels.push_back(waveform.levels[i]);
+  }
+
+  AskReceiver receiver;
+  AskSoftReceiver soft_receiver(soft ? *soft : AskSoftOptions());
+  AskLinkResult result;
+  double period =
+      bit_period / ASK_RX_SAMPLES_PER_BIT * (1 + channel.clock_skew);
+  size_t edge = 0;
+  bool level = false;
+  for (double t = unit(rng) * period; t < waveform.end; t += period) {
+    while (edge < times.size() && times[edge] <= t)
+      level = levels[edge++];
+
+    double signal = level;
+    if (flips.active(t, rng))
+      signal = 1 - signal;
+    if (dropouts.active(t, rng))
+      signal *= channel.dropout_level;
+    if (channel.noise > 0)
+      signal += gaussian(rng);
+
+    if (soft && soft_receiver.sample(signal > 0.5))
+      result.soft_frames.push_back(
+          {t, std::vector<uint8_t>(soft_receiver.frame(),
+                                   soft_receiver.frame() +
+                                       soft_receiver.frameLen())});
+    if (receiver.sample(signal > 0.5)) {
+      AskFrame frame = {t, std::vector<uint8_t>(receiver.frame(),
+                                                receiver.frame() +
+                                                    receiver.frameLen())};
+      if (receiver.validate())
+        result.frames.push_back(std::move(frame));
+      else
+        result.corrupted.push_back(std::move(frame));
+      receiver.restart();
+    }
+  }
+  result.bad = receiver.rxBad();
+  result.stats = receiver.stats();
+  result.soft_repaired = soft_receiver.rxRepaired();
+  return result;
+}
+
+unsigned askDelivered(const std::vector<AskFrame> &sent,
+                      const std::vector<AskFrame> &received) {
+  std::vector<const AskFrame *> left;
+  for (const AskFrame &frame : received)
+    left.push_back(&frame);
+  unsigned delivered = 0;
+  for (const AskFrame &frame : sent) {
+    auto match = std::find_if(
+        left.begin(), left.end(),
+        [&](const AskFrame *other) { return other->bytes == frame.bytes; });
+    if (match != left.end()) {
+      left.erase(match);
+      delivered++;
+    }
+  }
+  return delivered;
+}
+
+static void countBitErrors(const std::vector<AskFrame> &sent,
+                           const AskFrame &frame, double bit_period,
+                           AskBitErrors &errors) {
+  // the sent frame that ended closest, within 2 symbols
+  auto next = std::lower_bound(
+      sent.begin(), sent.end(), frame.end,
+      [](const AskFrame &other, double end) { return other.end < end; });
+  const AskFrame *closest = nullptr;
+  double distance = 12 * bit_period;
+  size_t index = next - sent.begin();
+  for (size_t i = index ? index - 1 : 0; i <= index && i < sent.size(); i++) {
+    if (std::abs(sent[i].end - frame.end) < distance) {
+      distance = std::abs(sent[i].end - frame.end);
+      closest = &sent[i];
+    }
+  }
+  if (!closest)
+    return;
+
+  size_t common = std::min(frame.bytes.size(), closest->bytes.size());
+  size_t longest = std::max(frame.bytes.size(), closest->bytes.size());
+  for (size_t i = 0; i < common; i++)
+    errors.errors += __builtin_popcount(frame.bytes[i] ^ closest->bytes[i]);
+  errors.errors += 8 * (longest - common);
+  errors.bits += 8 * longest;
+}
+
+AskBitErrors askBitErrors(const std::vector<AskFrame> &sent,
+                          const AskLinkResult &result, double bit_period) {
+  AskBitErrors errors;
+  for (const AskFrame &frame : result.frames)
+    countBitErrors(sent, frame, bit_period, errors);
+  for (const AskFrame &frame : result.corrupted)
+    countBitErrors(sent, frame, bit_period, errors);
+  return errors;
+}
@@ -0,0 +1,102 @@
+#ifndef ASK_LINK_HPP
+#define ASK_LINK_HPP
+
+#include "ask_receiver.hpp"
+#include "ask_soft_receiver.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Simulated radio link: the transmitter pin waveform of a station goes through
+// a channel model into the RH_ASK receiver (AskReceiver), which samples it 8
+// times per bit with its own clock.
+
+// Level of the transmitter pin over time, it changes to levels[i] at times[i]
+// and is low before the first change.
+struct AskWaveform {
+  std::vector<double> times; // s, ascending
+  std::vector<uint8_t> levels;
+  double end = 0; // s, end of the recording
+};
+
+// Impairments between the transmitter pin and the receiver output
+struct AskChannel {
+  // standard deviation of gaussian noise on the signal, which is 0 or 1 at
+  // the receiver's slicer (threshold 0.5). Also makes the receiver output
+  // toggle between frames like the AGC of a real one does.
+  double noise = 0;
+  // glitches that invert the signal for one bit period, per bit period
+  double flip_rate = 0;
+  // relative error of the receiver clock, 0.01 samples 1% slower
+  double clock_skew = 0;
+  // fades of the carrier: rate per second, mean length in seconds and the
+  // signal amplitude during a fade
+  double dropout_rate = 0;
+  double dropout_length = 0;
+  double dropout_level = 0;
+  // Edge timing of transmitter and receiver in seconds, independent of the
+  // bit rate: standard deviation of a gaussian delay of every edge, and how
+  // much longer the receiver output stays high than the carrier (slow AGC or
+  // slicer of OOK receivers)
+  double edge_jitter = 0;
+  double pulse_stretch = 0;
+};
+
+// A frame as count byte, headers, payload and CRC, and when its last bit ended
+struct AskFrame {
+  double end; // s
+  std::vector<uint8_t> bytes;
+};
+
+struct AskLinkResult {
+  // frames with a good CRC
+  std::vector<AskFrame> frames;
+  // frames the receiver collected completely that failed the CRC
+  std::vector<AskFrame> corrupted;
+  // frames dropped for their count byte or CRC
+  unsigned bad = 0;
+  AskReceiverStats stats;
+  // frames of an AskSoftReceiver on the same samples, if one was asked for,
+  // and how many of them it repaired
+  std::vector<AskFrame> soft_frames;
+  unsigned soft_repaired = 0;
+};
+
+struct AskBitErrors {
+  uint64_t bits = 0;
+  uint64_t errors = 0;
+};
+
+// Bit period the firmware's Timer1 generates for speed bits/s at F_CPU,
+// quantised like in AskTransmitter
+double askBitPeriod(uint16_t speed);
+
+// airtime of a frame with len bytes payload including the preamble
+double askAirtime(uint8_t len, double bit_period);
+
+// Appends a frame (preamble, headers, payload and CRC) starting at start to
+// the waveform, the pin goes low one bit period after the last bit. Returns
+// the frame as the receiver reassembles it.
+AskFrame askModulate(AskWaveform &waveform, double start, double bit_period,
+                     const uint8_t *headers, const uint8_t *data, uint8_t len);
+
+// Runs the waveform through the channel into a receiver that expects
+// bit_period. The receiver starts sampling at a random phase. With soft an
+// AskSoftReceiver with these options gets the same samples.
+AskLinkResult askRunLink(const AskWaveform &waveform, double bit_period,
+                         const AskChannel &channel, std::mt19937 &rng,
+                         const AskSoftOptions *soft = nullptr);
+
+// Number of frames in sent that are in received, each counted once
+unsigned askDelivered(const std::vector<AskFrame> &sent,
+                      const std::vector<AskFrame> &received);
+
+// Bit errors of the frames the receiver collected (good and corrupted)
+// against the sent frame that ended at the same time, sent ordered by end.
+// Bytes missing at the end of a shorter frame count as 8 errors each. Frames
+// the receiver never synchronised to count in the delivery ratio only.
+AskBitErrors askBitErrors(const std::vector<AskFrame> &sent,
+                          const AskLinkResult &result, double bit_period);
+
+#endif
@@ -0,0 +1,105 @@
+#include "ask_receiver.hpp"
+
+#include <algorithm>
+
+// symbol_6to4() of RH_ASK: invalid symbols decode as 0, the CRC rejects them
+static uint8_t symbol6to4(uint8_t symbol) {
+  uint8_t nybble = askDecodeSymbol(symbol);
+  return nybble == ASK_INVALID_SYMBOL ? 0 : nybble;
+}
+
+bool AskReceiver::sample(bool rx) {
+  if (_rxBufFull)
+    return false;
+
+  // Integrate each sample
+  if (rx)
+    _rxIntegrator++;
+
+  if (rx != _rxLastSample) {
+    if (_rxActive) {
+      uint8_t error = _rxPllRamp < ASK_RX_RAMP_TRANSITION
+                          ? _rxPllRamp
+                          : ASK_RX_RAMP_LEN - _rxPllRamp;
+      _stats.transitions++;
+      _stats.phase_error_sum += error;
+      if (error > _stats.max_phase_error)
+        _stats.max_phase_error = error;
+    }
+    // Transition, advance if ramp > 80, retard if < 80
+    _rxPllRamp += _rxPllRamp < ASK_RX_RAMP_TRANSITION ? ASK_RX_RAMP_INC_RETARD
+                                                      : ASK_RX_RAMP_INC_ADVANCE;
+    _rxLastSample = rx;
+  } else {
+    // No transition, advance ramp by standard 20 (== 160/8 samples)
+    _rxPllRamp += ASK_RX_RAMP_INC;
+  }
+  if (_rxPllRamp < ASK_RX_RAMP_LEN)
+    return false;
+
+  uint8_t integrator = _rxIntegrator;
+  _rxPllRamp -= ASK_RX_RAMP_LEN;
+  _rxIntegrator = 0;
+  // a retarded PLL sees more than 8 samples in a bit
+  if (_rxActive)
+    _stats.integrator[std::min<uint8_t>(integrator, ASK_RX_SAMPLES_PER_BIT)]++;
+  return bit(integrator >= ASK_RX_ONE_THRESHOLD);
+}
+
+bool AskReceiver::bit(bool one) {
+  if (_rxBufFull)
+    return false;
+
+  // Add this to the 12th bit of _rxBits, LSB first. The last 12 bits are kept.
+  _rxBits >>= 1;
+  if (one)
+    _rxBits |= 0x800;
+
+  if (!_rxActive) {
+    // Not in a message, see if we have a start symbol
+    if (_rxBits == ASK_RX_START_SYMBOL) {
+      _rxActive = true;
+      _rxBitCount = 0;
+      _rxBufLen = 0;
+    }
+    return false;
+  }
+
+  // 12 bits are one byte, 2 symbols of 6 bits with the high nybble first
+  if (++_rxBitCount < 12)
+    return false;
+  _rxBitCount = 0;
+  uint8_t byte = symbol6to4(_rxBits & 0x3f) << 4 | symbol6to4(_rxBits >> 6);
+
+  // The first byte is the byte count, it includes itself, the 4 byte header
+  // and the 2 byte CRC
+  if (_rxBufLen == 0) {
+    _rxCount = byte;
+    if (_rxCount < ASK_FRAME_OVERHEAD || _rxCount > ASK_MAX_FRAME_LEN) {
+      _rxActive = false;
+      _rxBad++;
+      return false;
+    }
+  }
+  _rxBuf[_rxBufLen++] = byte;
+  if (_rxBufLen < _rxCount)
+    return false;
+
+  _rxActive = false;
+  _rxBufFull = true;
+  return true;
+}
+
+bool AskReceiver::validate() {
+  if (!askCheckCrc(_rxBuf, _rxBufLen)) {
+    _rxBad++;
+    return false;
+  }
+  _rxGood++;
+  return true;
+}
+
+void AskReceiver::restart() {
+  _rxBufFull = false;
+  _rxBufLen = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef ASK_RECEIVER_HPP
+#define ASK_RECEIVER_HPP
+
+#include "ask_codec.hpp"
+
+#include <cstdint>
+
+// Host port of the RH_ASK receiver: the PLL, integrator and start symbol
+// search of RH_ASK::receiveTimer() and the CRC check of validateRxBuf(),
+// without the timer and pin handling. Feed it the receiver output 8 times per
+// bit with sample(), or bits decided elsewhere with bit().
+//
+// Besides the RH_ASK state it keeps statistics on how close the decisions
+// inside frames came to failing (see AskReceiverStats).
+
+#define ASK_RX_SAMPLES_PER_BIT 8
+#define ASK_RX_RAMP_LEN 160
+#define ASK_RX_RAMP_INC (ASK_RX_RAMP_LEN / ASK_RX_SAMPLES_PER_BIT)
+#define ASK_RX_RAMP_TRANSITION (ASK_RX_RAMP_LEN / 2)
+#define ASK_RX_RAMP_ADJUST 9
+#define ASK_RX_RAMP_INC_RETARD (ASK_RX_RAMP_INC - ASK_RX_RAMP_ADJUST)
+#define ASK_RX_RAMP_INC_ADVANCE (ASK_RX_RAMP_INC + ASK_RX_RAMP_ADJUST)
+
+// preamble end and start symbol as they sit in the 12 bit shift register
+#define ASK_RX_START_SYMBOL 0xb38
+
+// integrator count from which a bit is a 1
+#define ASK_RX_ONE_THRESHOLD 5
+
+struct AskReceiverStats {
+  // Transitions while collecting a frame and how far the PLL ramp was from
+  // wrapping around when they came in. The PLL locks the wrap (where a bit
+  // ends) to the transitions, at half a bit (ASK_RX_RAMP_TRANSITION) it loses
+  // track of the bits.
+  uint32_t transitions = 0;
+  uint64_t phase_error_sum = 0;
+  uint8_t max_phase_error = 0;
+
+  // bits decided while collecting a frame by the number of high samples, more
+  // than 8 counted as 8
+  uint32_t integrator[ASK_RX_SAMPLES_PER_BIT + 1] = {};
+};
+
+class AskReceiver {
+public:
+  AskReceiver() { restart(); }
+
+  // One sample of the receiver output. Returns true when the last byte of a
+  // frame came in, the receiver then ignores samples until restart().
+  bool sample(bool rx);
+
+  // One bit, bypassing the PLL and integrator. Returns true like sample().
+  bool bit(bool one);
+
+  // true while collecting a frame after its start symbol
+  bool active() const { return _rxActive; }
+
+  // Frame of the last sample() that returned true: count byte, headers,
+  // payload and CRC
+  const uint8_t *frame() const { return _rxBuf; }
+  uint8_t frameLen() const { return _rxBufLen; }
+
+  // validateRxBuf(): true if the CRC of the frame is good, counts bad frames
+  bool validate();
+
+  // clears the received frame and searches for the next start symbol
+  void restart();
+
+  // frames with a bad count byte or CRC
+  uint16_t rxBad() const { return _rxBad; }
+  uint16_t rxGood() const { return _rxGood; }
+
+  const AskReceiverStats &stats() const { return _stats; }
+
+private:
+  bool _rxLastSample = false;
+  uint8_t _rxPllRamp = 0;
+  uint8_t _rxIntegrator = 0;
+  uint16_t _rxBits = 0;
+  bool _rxActive = false;
+  bool _rxBufFull = false;
+  uint8_t _rxBitCount = 0;
+  uint8_t _rxCount = 0;
+  uint8_t _rxBuf[ASK_MAX_FRAME_LEN];
+  uint8_t _rxBufLen = 0;
+  uint16_t _rxBad = 0;
+  uint16_t _rxGood = 0;
+  AskReceiverStats _stats;
+};
+
+#endif
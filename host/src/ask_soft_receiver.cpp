@@ -0,0 +1,193 @@
+#include "ask_soft_receiver.hpp"
+#include "ask_batch_codec.hpp"
+
+#include <algorithm>
+
+// bits of history kept before the oldest candidate is trimmed off
+static const uint64_t TRIM_BITS = 1024;
+
+// cost of deciding the other way on a bit with integrator high samples, the
+// distance from the threshold in half samples
+static uint8_t flipCost(uint8_t integrator) {
+  return integrator >= ASK_RX_ONE_THRESHOLD
+             ? 2 * integrator - (2 * ASK_RX_ONE_THRESHOLD - 1)
+             : (2 * ASK_RX_ONE_THRESHOLD - 1) - 2 * integrator;
+}
+
+AskSoftReceiver::AskSoftReceiver(const AskSoftOptions &options)
+    : _options(options) {}
+
+bool AskSoftReceiver::sample(bool rx) {
+  // PLL and integrator as in AskReceiver::sample()
+  if (rx)
+    _rxIntegrator++;
+  if (rx != _rxLastSample) {
+    _rxPllRamp += _rxPllRamp < ASK_RX_RAMP_TRANSITION ? ASK_RX_RAMP_INC_RETARD
+                                                      : ASK_RX_RAMP_INC_ADVANCE;
+    _rxLastSample = rx;
+  } else {
+    _rxPllRamp += ASK_RX_RAMP_INC;
+  }
+  if (_rxPllRamp < ASK_RX_RAMP_LEN)
+    return false;
+
+  uint8_t integrator = _rxIntegrator;
+  _rxPllRamp -= ASK_RX_RAMP_LEN;
+  _rxIntegrator = 0;
+  return bit(integrator);
+}
+
+bool AskSoftReceiver::bit(uint8_t integrator) {
+  _rxBits >>= 1;
+  if (integrator >= ASK_RX_ONE_THRESHOLD)
+    _rxBits |= 0x800;
+  _soft.push_back(integrator);
+  uint64_t next = _dropped + _soft.size();
+
+  bool received = false;
+  for (size_t i = 0; i < _candidates.size();) {
+    Candidate &candidate = _candidates[i];
+    bool alive = advance(candidate);
+    if (alive && (!candidate.count ||
+                  candidate.symbols.size() < 2u * candidate.count)) {
+      i++;
+      continue;
+    }
+    if (alive && repair(candidate)) {
+      // the frame ends here, whatever else started before is part of it
+      _rxGood++;
+      _candidates.clear();
+      received = true;
+      break;
+    }
+    if (candidate.exact)
+      _rxBad++;
+    _candidates.erase(_candidates.begin() + i);
+  }
+
+  uint8_t errors = __builtin_popcount(_rxBits ^ ASK_RX_START_SYMBOL);
+  if (errors <= _options.start_errors)
+    _candidates.push_back({next, errors == 0, 0, 0, {}});
+
+  if (_candidates.empty()) {
+    _soft.clear();
+    _dropped = next;
+  } else if (_candidates.front().start - _dropped >= TRIM_BITS) {
+    _soft.erase(_soft.begin(),
+                _soft.begin() + (_candidates.front().start - _dropped));
+    _dropped = _candidates.front().start;
+  }
+  return received;
+}
+
+bool AskSoftReceiver::advance(Candidate &candidate) {
+  uint64_t bits = _dropped + _soft.size() - candidate.start;
+  while ((candidate.symbols.size() + 1) * 6 <= bits &&
+         (!candidate.count ||
+          candidate.symbols.size() < 2u * candidate.count)) {
+    bool invalid;
+    candidate.symbols.push_back(
+        symbol(candidate.start + 6 * candidate.symbols.size(), invalid));
+    if (invalid && ++candidate.invalid > _options.invalid_symbols)
+      return false;
+
+    // the count byte sets the length, like in AskReceiver::bit()
+    if (candidate.symbols.size() == 2) {
+      candidate.count =
+          candidate.symbols[0].best << 4 | candidate.symbols[1].best;
+      if (candidate.count < ASK_FRAME_OVERHEAD ||
+          candidate.count > ASK_MAX_FRAME_LEN)
+        return false;
+    }
+  }
+  return true;
+}
+
+AskSoftReceiver::Symbol AskSoftReceiver::symbol(uint64_t first,
+                                                bool &invalid) const {
+  uint8_t hard = 0;
+  uint8_t costs[6];
+  for (int i = 0; i < 6; i++) {
+    uint8_t integrator = softBit(first + i);
+    if (integrator >= ASK_RX_ONE_THRESHOLD)
+      hard |= 1 << i;
+    costs[i] = flipCost(integrator);
+  }
+  invalid = askDecodeSymbol(hard) == ASK_INVALID_SYMBOL;
+
+  // the valid symbols by the confidence of the bits they differ in
+  uint8_t best = 0, second = 0;
+  unsigned best_cost = ~0u, second_cost = ~0u;
+  for (uint8_t nybble = 0; nybble < 16; nybble++) {
+    uint8_t differ = hard ^ ask_symbols[nybble];
+    unsigned cost = 0;
+    for (int i = 0; i < 6; i++)
+      if (differ & (1 << i))
+        cost += costs[i];
+    if (cost < best_cost) {
+      second = best;
+      second_cost = best_cost;
+      best = nybble;
+      best_cost = cost;
+    } else if (cost < second_cost) {
+      second = nybble;
+      second_cost = cost;
+    }
+  }
+  return {best, second, uint8_t(second_cost - best_cost)};
+}
+
+bool AskSoftReceiver::repair(const Candidate &candidate) {
+  const std::vector<Symbol> &symbols = candidate.symbols;
+  uint8_t len = candidate.count;
+  uint8_t decided[ASK_MAX_FRAME_LEN];
+  for (uint8_t i = 0; i < len; i++)
+    decided[i] = symbols[2 * i].best << 4 | symbols[2 * i + 1].best;
+
+  // The least confident symbols after the count byte, which fixed the
+  // length. Of their combinations at the second best value the one that
+  // costs the least and passes the CRC wins, none if the decided symbols do.
+  std::vector<uint8_t> weak;
+  for (uint8_t i = 2; i < symbols.size(); i++)
+    weak.push_back(i);
+  size_t flips = std::min<size_t>(_options.flip_symbols, weak.size());
+  std::partial_sort(weak.begin(), weak.begin() + flips, weak.end(),
+                    [&](uint8_t a, uint8_t b) {
+                      return symbols[a].margin < symbols[b].margin;
+                    });
+  auto flip = [&](unsigned mask, uint8_t *frame) {
+    std::copy(decided, decided + len, frame);
+    unsigned cost = 0;
+    for (size_t j = 0; j < flips; j++) {
+      if (!(mask & (1 << j)))
+        continue;
+      uint8_t i = weak[j];
+      // the high nybble is the first symbol of a byte
+      uint8_t shift = i % 2 ? 0 : 4;
+      frame[i / 2] = (frame[i / 2] & ~(0x0f << shift)) |
+                     symbols[i].second << shift;
+      cost += symbols[i].margin;
+    }
+    return cost;
+  };
+
+  uint8_t frame[ASK_MAX_FRAME_LEN];
+  unsigned best_cost = ~0u, best_mask = 0;
+  for (unsigned mask = 0; mask < 1u << flips; mask++) {
+    unsigned cost = flip(mask, frame);
+    if (cost < best_cost && askCheckCrcFast(frame, len)) {
+      best_cost = cost;
+      best_mask = mask;
+      if (!mask)
+        break;
+    }
+  }
+  if (best_cost == ~0u)
+    return false;
+
+  flip(best_mask, _frame);
+  _frameLen = len;
+  if (best_mask || !candidate.exact || candidate.invalid)
+    _rxRepaired++;
+  return true;
+}
@@ -0,0 +1,103 @@
+#ifndef ASK_SOFT_RECEIVER_HPP
+#define ASK_SOFT_RECEIVER_HPP
+
+#include "ask_receiver.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Soft-decision variant of AskReceiver for the host. The PLL and integrator
+// are those of RH_ASK, but instead of deciding every bit at 5 of 8 high
+// samples and forgetting how close the decision was, it keeps the integrator
+// count of each bit:
+// - start symbols within options.start_errors bits of ASK_RX_START_SYMBOL
+//   open a frame, several frames may be open at once so a false start in the
+//   noise does not hide a real one
+// - every 6 bit symbol decodes to the valid symbol whose differing bits were
+//   the least confident, symbol_6to4() of RH_ASK maps invalid ones to 0.
+//   Frames with more than options.invalid_symbols invalid symbols are noise.
+// - if the CRC fails, the least confident symbols are tried at their second
+//   best value until it passes.
+//   Each try passes a corrupted frame with a chance of 1 in 65536.
+// The stations send the same frames as before.
+
+struct AskSoftOptions {
+  // bits in which a start symbol may differ, a shift of the preamble and
+  // start symbol by a bit differs in more than 3
+  uint8_t start_errors = 2;
+  // invalid symbols up to which a frame is repaired
+  uint8_t invalid_symbols = 5;
+  // least confident symbols tried at their second best value, 2^n - 1 more
+  // CRC checks
+  uint8_t flip_symbols = 4;
+};
+
+class AskSoftReceiver {
+public:
+  explicit AskSoftReceiver(const AskSoftOptions &options = AskSoftOptions());
+
+  // One sample of the receiver output. Returns true when a frame with a good
+  // CRC came in, it stays in frame() until the next frame.
+  bool sample(bool rx);
+
+  // One bit given as the number of high samples out of
+  // ASK_RX_SAMPLES_PER_BIT, bypassing the PLL and integrator
+  bool bit(uint8_t integrator);
+
+  // count byte, headers, payload and CRC of the last frame
+  const uint8_t *frame() const { return _frame; }
+  uint8_t frameLen() const { return _frameLen; }
+
+  // frames with a good CRC
+  uint32_t rxGood() const { return _rxGood; }
+  // of those the frames AskReceiver loses: start symbol with errors, invalid
+  // symbols or CRC passed after trying other symbols
+  uint32_t rxRepaired() const { return _rxRepaired; }
+  // frames after an exact start symbol that could not be repaired
+  uint32_t rxBad() const { return _rxBad; }
+
+private:
+  struct Symbol {
+    uint8_t best;
+    uint8_t second;
+    // cost of the second best over the best symbol
+    uint8_t margin;
+  };
+
+  // a frame after a start symbol
+  struct Candidate {
+    uint64_t start; // first bit after the start symbol
+    bool exact;     // start symbol without errors
+    uint8_t count;  // count byte, 0 until decoded
+    uint8_t invalid;
+    std::vector<Symbol> symbols;
+  };
+
+  // Decodes the symbols complete since the last bit, false to drop the
+  // candidate
+  bool advance(Candidate &candidate);
+  // Finds the frame with a good CRC, false if there is none
+  bool repair(const Candidate &candidate);
+  Symbol symbol(uint64_t first, bool &invalid) const;
+  uint8_t softBit(uint64_t bit) const { return _soft[bit - _dropped]; }
+
+  AskSoftOptions _options;
+
+  bool _rxLastSample = false;
+  uint8_t _rxPllRamp = 0;
+  uint8_t _rxIntegrator = 0;
+  uint16_t _rxBits = 0;
+
+  // integrator counts from bit _dropped on, as long as a candidate needs them
+  std::vector<uint8_t> _soft;
+  uint64_t _dropped = 0;
+  std::vector<Candidate> _candidates;
+
+  uint8_t _frame[ASK_MAX_FRAME_LEN];
+  uint8_t _frameLen = 0;
+  uint32_t _rxGood = 0;
+  uint32_t _rxRepaired = 0;
+  uint32_t _rxBad = 0;
+};
+
+#endif
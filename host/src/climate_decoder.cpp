@@ -0,0 +1,98 @@
+#include "climate_decoder.hpp"
+#include "climate_protocol.hpp"
+
+#include <cstring>
+
+double hdc1080Temperature(uint16_t code) {
+  return code * 165.0 / (1 << CLIMATE_CODE_BITS) - 40.0;
+}
+
+double hdc1080Humidity(uint16_t code) {
+  return code * 100.0 / (1 << CLIMATE_CODE_BITS);
+}
+
+// Format 1 is the raw firmware struct, optionally followed by the available
+// stack size when the station was built with USE_STACK_COUNTING
+static bool decodeV1(const uint8_t *payload, double rx_time,
+                     std::vector<Measurement> &measurements) {
+  // AVR floats are little endian IEEE 754 singles
+  float temperature, humidity;
+  std::memcpy(&temperature, payload, sizeof(float));
+  std::memcpy(&humidity, payload + sizeof(float), sizeof(float));
+
+  Measurement measurement;
+  measurement.format = CLIMATE_FORMAT_V1;
+  measurement.timestamp = rx_time;
+  measurement.temperature = temperature;
+  measurement.humidity = humidity;
+  measurement.battery = payload[2 * sizeof(float)];
+  measurement.battery_mv = 0;
+  measurement.station_id = payload[2 * sizeof(float) + 1];
+  measurements.push_back(measurement);
+  return true;
+}
+
+static Measurement fromCodes(uint8_t station_id, uint8_t format,
+                             uint16_t temperature, uint16_t humidity,
+                             uint8_t battery) {
+  Measurement measurement;
+  measurement.station_id = station_id;
+  measurement.format = format;
+  measurement.timestamp = 0;
+  measurement.temperature = hdc1080Temperature(temperature);
+  measurement.humidity = hdc1080Humidity(humidity);
+  measurement.battery_mv = climateBatteryMillivolts(battery);
+  measurement.battery = measurement.battery_mv ? 0 : battery;
+  return measurement;
+}
+
+static bool decodeBatch(uint8_t from_header, const uint8_t *payload,
+                        size_t len, double rx_time,
+                        std::vector<Measurement> &measurements,
+                        double tick_seconds) {
+  ClimateBatchSample samples[CLIMATE_BATCH_MAX_SAMPLES];
+  uint8_t count, battery;
+  if (!climateUnpackBatch(payload, len, samples, &count, &battery))
+    return false;
+
+  // the last sample is taken right before sending, walk the offsets back
+  size_t first = measurements.size();
+  measurements.resize(first + count);
+  double timestamp = rx_time;
+  for (int i = count - 1; i >= 0; i--) {
+    measurements[first + i] =
+        fromCodes(from_header, CLIMATE_FORMAT_V3, samples[i].temperature,
+                  samples[i].humidity, battery);
+    measurements[first + i].timestamp = timestamp;
+    timestamp -= samples[i].offset * tick_seconds;
+  }
+  return true;
+}
+
+bool decodePayload(uint8_t from_header, const uint8_t *payload, size_t len,
+                   double rx_time, std::vector<Measurement> &measurements,
+                   double tick_seconds) {
+  if (len == CLIMATE_V1_PAYLOAD_LEN ||
+      len == CLIMATE_V1_STACK_COUNTING_PAYLOAD_LEN)
+    return decodeV1(payload, rx_time, measurements);
+  if (len == 0)
+    return false;
+
+  switch (climateFormatTag(payload)) {
+  case CLIMATE_FORMAT_V2: {
+    ClimateSample sample;
+    if (!climateUnpackV2(payload, len, &sample))
+      return false;
+    measurements.push_back(fromCodes(from_header, CLIMATE_FORMAT_V2,
+                                     sample.temperature, sample.humidity,
+                                     sample.battery));
+    measurements.back().timestamp = rx_time;
+    return true;
+  }
+  case CLIMATE_FORMAT_V3:
+    return decodeBatch(from_header, payload, len, rx_time, measurements,
+                       tick_seconds);
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef CLIMATE_DECODER_HPP
+#define CLIMATE_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// nominal watchdog wakeup period of the stations in seconds (WATCHDOG_TIME)
+#define CLIMATE_DEFAULT_TICK_SECONDS 8.0
+
+// A decoded measurement in physical units
+struct Measurement {
+  uint8_t station_id;
+  uint8_t format;     // payload format the measurement was sent with
+  double timestamp;   // when the sample was taken, in the clock of rx_time
+  double temperature; // degree Celsius
+  double humidity;    // percent relative humidity
+  uint8_t battery;    // percent, 0 if the station reports its voltage
+  uint16_t battery_mv; // supply voltage in mV, 0 if it reports a percentage
+};
+
+// HDC1080 conversions (datasheet section 8.6.1/8.6.2) for 14 bit codes
+double hdc1080Temperature(uint16_t code);
+double hdc1080Humidity(uint16_t code);
+
+// Decodes a RadioHead payload received at rx_time (seconds) and appends its
+// samples to measurements, oldest first. from_header is the FROM header of the
+// frame, which carries the station id for bit-packed formats. Batched samples
+// are timestamped backwards from rx_time with their wakeup offsets times
+// tick_seconds. Returns false if the payload matches no known format.
+bool decodePayload(uint8_t from_header, const uint8_t *payload, size_t len,
+                   double rx_time, std::vector<Measurement> &measurements,
+                   double tick_seconds = CLIMATE_DEFAULT_TICK_SECONDS);
+
+#endif
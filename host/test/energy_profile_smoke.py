@@ -0,0 +1,108 @@
+# Smoke test of the energy profiler against a real simavr:
+#
+#   energy_profile_smoke.py energy_profile link_sim firmware.elf
+#
+# Runs the firmware built with PROFILE_PHASES (pio run -e attiny85-profile)
+# for SECONDS simulated seconds and checks what has to hold whatever the
+# current model says: the firmware marks every loop phase, the emulated
+# USI/HDC1080 bus delivers the samples the send policy asks for, frames go
+# out, the station spends its time in power down and the stack stays inside
+# the 512 bytes of RAM. The transmitter pin the profiler writes (-w) then
+# goes through link_sim into the host RH_ASK receiver, which has to decode
+# every frame the firmware sent. Exits with SKIP (ctest SKIP_RETURN_CODE) if
+# the firmware is not built.
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+SECONDS = 600
+SKIP = 77
+
+# one sample every 2 to 14 watchdog wakeups of 8 s (SEND_POLICY_MIN_INTERVAL,
+# SEND_POLICY_MAX_INTERVAL) plus the TDMA stretch of up to a wakeup
+MIN_SAMPLES = SECONDS // ((14 + 1) * 8)
+MAX_SAMPLES = SECONDS // (2 * 8) + 1
+
+RAM = 512
+MIN_STACK = 8  # return addresses of loop() and the interrupts at least
+
+
+def check(failures, ok, message):
+    if not ok:
+        failures.append(message)
+
+
+def delivered(link_sim, waveform):
+    # frames the receiver decoded and frames in the waveform, None on failure
+    result = subprocess.run([link_sim, waveform], stdout=subprocess.PIPE)
+    match = re.search(r"\((\d+) of (\d+) frames\)", result.stdout.decode())
+    if result.returncode or not match:
+        return None
+    return int(match.group(1)), int(match.group(2))
+
+
+def main(profiler, link_sim, firmware):
+    if not os.path.exists(firmware):
+        print("%s not built, run pio run -e attiny85-profile" % firmware)
+        return SKIP
+
+    with tempfile.TemporaryDirectory() as directory:
+        waveform = os.path.join(directory, "tx.txt")
+        result = subprocess.run([profiler, "-t", str(SECONDS), "-i", "13",
+                                 "-w", waveform, firmware],
+                                stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        sys.stderr.write(result.stderr.decode())
+        if result.returncode:
+            print("energy_profile failed with %d" % result.returncode)
+            return 1
+        frames = delivered(link_sim, waveform)
+    profile = json.loads(result.stdout.decode())
+    phases = profile["phases"]
+
+    failures = []
+    check(failures, profile["simulated_s"] >= SECONDS,
+          "simulated %.1f s" % profile["simulated_s"])
+    for name in ("measure", "encode", "transmit", "sleep"):
+        check(failures, phases[name]["entries"] > 0,
+              "phase %s never entered" % name)
+    samples = profile["samples"]
+    check(failures, MIN_SAMPLES <= samples <= MAX_SAMPLES,
+          "%d samples, expected %d to %d" % (samples, MIN_SAMPLES,
+                                             MAX_SAMPLES))
+    # one conversion per loop, pipelined firmware converts twice in the first
+    check(failures, abs(phases["sleep"]["entries"] - samples) <= 2,
+          "%d samples in %d sleep cycles" % (samples,
+                                              phases["sleep"]["entries"]))
+    check(failures, 1 <= profile["frames"] <= samples,
+          "%d frames for %d samples" % (profile["frames"], samples))
+    # the pipelined firmware measures while the frame goes out
+    check(failures, sum(phase["radio_s"] for phase in phases.values()) > 0,
+          "transmitter never keyed")
+    check(failures, phases["sleep"]["power_down_s"] > 0.9 * SECONDS,
+          "%.1f s of %d s in power down" % (phases["sleep"]["power_down_s"],
+                                            SECONDS))
+    stack = profile["stack_bytes"]
+    check(failures, MIN_STACK <= stack < RAM, "stack %d bytes" % stack)
+    check(failures, frames is not None, "link_sim failed")
+    if frames is not None:
+        check(failures, frames == (profile["frames"], profile["frames"]),
+              "receiver decoded %d of %d frames in the waveform, firmware "
+              "sent %d" % (frames + (profile["frames"],)))
+
+    for failure in failures:
+        print(failure)
+    if not failures:
+        print("%d samples, %d frames, stack %d bytes, %.2f uA" %
+              (samples, profile["frames"], stack, profile["average_ua"]))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 4:
+        print("usage: energy_profile_smoke.py energy_profile link_sim "
+              "firmware.elf")
+        sys.exit(2)
+    sys.exit(main(sys.argv[1], sys.argv[2], sys.argv[3]))
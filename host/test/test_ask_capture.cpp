@@ -0,0 +1,173 @@
+// Offline capture decoder
+#include "ask_capture.hpp"
+#include "ask_link.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// One byte per sample, 8 samples per bit, the receiver output in bit 2. Each
+// sample is inverted with probability flip, which also makes the idle line
+// between frames toggle.
+std::vector<uint8_t> capture(unsigned frames, double flip,
+                             std::vector<AskFrame> &sent, std::mt19937 &rng) {
+  AskWaveform waveform;
+  std::vector<uint8_t> payload(8);
+  for (unsigned i = 0; i < frames; i++) {
+    uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, uint8_t(i), 0};
+    for (uint8_t &byte : payload)
+      byte = rng();
+    // frames start at a random phase of the samples
+    double start = waveform.end + 50 + (rng() % 800) / 8.0 + 0.01;
+    sent.push_back(askModulate(waveform, start, 1, headers, payload.data(),
+                               payload.size()));
+  }
+  waveform.end += 50;
+
+  std::bernoulli_distribution flipped(flip);
+  std::vector<uint8_t> samples;
+  size_t edge = 0;
+  bool level = false;
+  for (double time = 0; time < waveform.end; time += 1.0 / 8) {
+    for (; edge < waveform.times.size() && waveform.times[edge] <= time; edge++)
+      level = waveform.levels[edge];
+    // other channels of the logic analyser
+    samples.push_back((rng() & ~4) | (level != flipped(rng)) << 2);
+  }
+  return samples;
+}
+
+// AskReceiver::sample() over the same samples, the frame taken out as soon
+// as it is complete
+std::vector<AskCaptureFrame> reference(const std::vector<uint8_t> &samples,
+                                       uint64_t &bad) {
+  AskReceiver receiver;
+  std::vector<AskCaptureFrame> frames;
+  for (size_t i = 0; i < samples.size() / 8 * 8; i++) {
+    if (!receiver.sample(samples[i] & 4))
+      continue;
+    if (receiver.validate())
+      frames.push_back({i, std::vector<uint8_t>(receiver.frame(),
+                                                receiver.frame() +
+                                                    receiver.frameLen())});
+    receiver.restart();
+  }
+  bad = receiver.rxBad();
+  return frames;
+}
+
+void expectSameFrames(const std::vector<AskCaptureFrame> &frames,
+                      const std::vector<AskCaptureFrame> &expected,
+                      double samples_apart = 0) {
+  ASSERT_EQ(frames.size(), expected.size());
+  for (size_t i = 0; i < frames.size(); i++) {
+    EXPECT_NEAR(double(frames[i].sample), expected[i].sample, samples_apart);
+    EXPECT_EQ(frames[i].bytes, expected[i].bytes);
+  }
+}
+
+} // namespace
+
+TEST(AskCapture, PacksSamples) {
+  std::mt19937 rng(1);
+  std::vector<uint8_t> samples(1003);
+  for (uint8_t &sample : samples)
+    sample = rng();
+  for (uint8_t channel : {0, 3, 7}) {
+    std::vector<uint8_t> bits((samples.size() + 7) / 8);
+    askPackSamples(samples.data(), samples.size(), channel, bits.data());
+    for (size_t i = 0; i < samples.size(); i++)
+      ASSERT_EQ(bits[i / 8] >> (i % 8) & 1, samples[i] >> channel & 1);
+  }
+}
+
+TEST(AskCapture, MatchesTheReceiver) {
+  std::mt19937 rng(2);
+  std::vector<AskFrame> sent;
+  std::vector<uint8_t> samples = capture(200, 0.02, sent, rng);
+  uint64_t bad;
+  std::vector<AskCaptureFrame> expected = reference(samples, bad);
+  // the flips cost some frames, and make the receiver find start symbols in
+  // the noise
+  EXPECT_GT(expected.size(), 100u);
+  EXPECT_LT(expected.size(), 200u);
+  EXPECT_GT(bad, 0u);
+
+  AskCaptureFormat format;
+  format.channel = 2;
+  AskCaptureResult result =
+      askDecodeCapture(samples.data(), samples.size(), format, 1);
+  expectSameFrames(result.frames, expected);
+  EXPECT_EQ(result.bad_count + result.bad_crc, bad);
+  EXPECT_EQ(result.samples, samples.size() / 8 * 8);
+}
+
+TEST(AskCapture, ChunksLoseNoFramesAtTheirBorders) {
+  std::mt19937 rng(3);
+  std::vector<AskFrame> sent;
+  std::vector<uint8_t> samples = capture(300, 0.003, sent, rng);
+  AskCaptureFormat format;
+  format.channel = 2;
+  AskCaptureResult single =
+      askDecodeCapture(samples.data(), samples.size(), format, 1);
+  // chunks of about 10 frames, their PLLs may lock a little apart from the
+  // single pass
+  AskCaptureResult chunked =
+      askDecodeCapture(samples.data(), samples.size(), format, 29);
+  EXPECT_EQ(chunked.threads, 29u);
+  expectSameFrames(chunked.frames, single.frames, ASK_RX_SAMPLES_PER_BIT / 2);
+  EXPECT_EQ(chunked.bad_count + chunked.bad_crc,
+            single.bad_count + single.bad_crc);
+  EXPECT_EQ(chunked.samples, single.samples);
+}
+
+TEST(AskCapture, DecodesPackedAndDecimatedCaptures) {
+  std::mt19937 rng(4);
+  std::vector<AskFrame> sent;
+  std::vector<uint8_t> samples = capture(20, 0, sent, rng);
+  AskCaptureFormat format;
+  format.channel = 2;
+  AskCaptureResult expected =
+      askDecodeCapture(samples.data(), samples.size(), format, 1);
+  ASSERT_EQ(expected.frames.size(), 20u);
+
+  std::vector<uint8_t> bits((samples.size() + 7) / 8);
+  askPackSamples(samples.data(), samples.size(), 2, bits.data());
+  AskCaptureFormat packed;
+  packed.packed = true;
+  expectSameFrames(askDecodeCapture(bits.data(), bits.size(), packed, 1).frames,
+                   expected.frames);
+
+  // a capture at 3 times the rate
+  std::vector<uint8_t> fast;
+  for (uint8_t sample : samples)
+    fast.insert(fast.end(), 3, sample);
+  format.decimation = 3;
+  expectSameFrames(askDecodeCapture(fast.data(), fast.size(), format, 1).frames,
+                   expected.frames);
+}
+
+TEST(AskCapture, ShortCapturesDecodeAlikeOnAnyNumberOfThreads) {
+  // chunks of a frame or two lost one of these 6 frames before they had a
+  // minimum length
+  std::mt19937 rng(11);
+  std::vector<AskFrame> sent;
+  std::vector<uint8_t> samples = capture(6, 0.003, sent, rng);
+  AskCaptureFormat format;
+  format.channel = 2;
+  AskCaptureResult single =
+      askDecodeCapture(samples.data(), samples.size(), format, 1);
+  for (unsigned threads = 2; threads <= 24; threads++) {
+    SCOPED_TRACE(threads);
+    AskCaptureResult result =
+        askDecodeCapture(samples.data(), samples.size(), format, threads);
+    expectSameFrames(result.frames, single.frames);
+    EXPECT_EQ(result.bad_count + result.bad_crc,
+              single.bad_count + single.bad_crc);
+    EXPECT_EQ(result.samples, single.samples);
+    EXPECT_EQ(result.threads, 1u);
+  }
+}
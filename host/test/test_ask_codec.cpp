@@ -0,0 +1,185 @@
+// RadioHead ASK framing: symbol table, CRC and the bit stream the transmitter
+// clocks out on its pin
+#include "ask_batch_codec.hpp"
+#include "ask_codec.hpp"
+#include "ask_transmitter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// bitwise CRC-CCITT, reflected polynomial 0x8408
+uint16_t crcReference(uint16_t crc, uint8_t data) {
+  crc ^= data;
+  for (int i = 0; i < 8; i++)
+    crc = crc & 1 ? (crc >> 1) ^ 0x8408 : crc >> 1;
+  return crc;
+}
+
+std::vector<uint8_t> randomBytes(std::mt19937 &rng, size_t len) {
+  std::vector<uint8_t> bytes(len);
+  for (uint8_t &byte : bytes)
+    byte = rng();
+  return bytes;
+}
+
+} // namespace
+
+TEST(AskCodec, CrcMatchesBitwiseReference) {
+  for (uint32_t crc = 0; crc <= 0xffff; crc += 97)
+    for (int data = 0; data < 256; data++)
+      ASSERT_EQ(askCrcUpdate(crc, data), crcReference(crc, data));
+}
+
+TEST(AskCodec, SymbolsAreBalancedAndDecodable) {
+  for (uint8_t nybble = 0; nybble < 16; nybble++) {
+    uint8_t symbol = ask_symbols[nybble];
+    EXPECT_EQ(__builtin_popcount(symbol), 3);
+    EXPECT_EQ(askDecodeSymbol(symbol), nybble);
+  }
+  int valid = 0;
+  for (int symbol = 0; symbol < 64; symbol++)
+    valid += askDecodeSymbol(symbol) != ASK_INVALID_SYMBOL;
+  EXPECT_EQ(valid, 16);
+}
+
+TEST(AskCodec, NybbleTableCrcMatchesByteCrc) {
+  for (uint32_t crc = 0; crc <= 0xffff; crc += 97)
+    for (int data = 0; data < 256; data++)
+      ASSERT_EQ(askCrcUpdateNybbles(crc, data), askCrcUpdate(crc, data));
+}
+
+TEST(AskCodec, SliceBy8CrcMatchesByteCrc) {
+  std::mt19937 rng(2);
+  std::vector<uint8_t> data = randomBytes(rng, 100);
+  for (size_t len = 0; len <= data.size(); len++) {
+    uint16_t crc = rng();
+    uint16_t expected = crc;
+    for (size_t i = 0; i < len; i++)
+      expected = askCrcUpdate(expected, data[i]);
+    ASSERT_EQ(askCrc(crc, data.data(), len), expected) << len;
+  }
+}
+
+TEST(AskCodec, BatchSymbolDecodeMatchesSymbolDecode) {
+  // every byte value 4 times in different lanes, and a tail shorter than 16
+  std::vector<uint8_t> symbols;
+  for (int round = 0; round < 4; round++)
+    for (int symbol = 0; symbol < 256; symbol++)
+      symbols.push_back(symbol * 17 + round);
+  symbols.resize(symbols.size() - 5);
+  std::vector<uint8_t> nybbles(symbols.size());
+  size_t invalid = 0;
+  for (uint8_t symbol : symbols)
+    invalid += askDecodeSymbol(symbol) == ASK_INVALID_SYMBOL;
+  ASSERT_EQ(askDecodeSymbols(symbols.data(), symbols.size(), nybbles.data()),
+            invalid);
+  for (size_t i = 0; i < symbols.size(); i++)
+    ASSERT_EQ(nybbles[i], askDecodeSymbol(symbols[i])) << int(symbols[i]);
+}
+
+TEST(AskCodec, EncodeDecodeRoundtrip) {
+  std::mt19937 rng(1);
+  for (uint8_t len = 0; len <= ASK_MAX_FRAME_LEN - ASK_FRAME_OVERHEAD; len++) {
+    std::vector<uint8_t> headers = randomBytes(rng, ASK_HEADER_LEN);
+    std::vector<uint8_t> payload = randomBytes(rng, len);
+    uint8_t symbols[2 * ASK_MAX_FRAME_LEN];
+    uint8_t num_symbols =
+        askEncode(headers.data(), payload.data(), len, symbols);
+    ASSERT_EQ(num_symbols, 2 * (len + ASK_FRAME_OVERHEAD));
+
+    uint8_t frame[ASK_MAX_FRAME_LEN];
+    ASSERT_EQ(askDecode(symbols, num_symbols, frame), len + ASK_FRAME_OVERHEAD);
+    EXPECT_TRUE(askCheckCrc(frame, frame[0]));
+    EXPECT_TRUE(std::equal(headers.begin(), headers.end(), frame + 1));
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(),
+                           frame + 1 + ASK_HEADER_LEN));
+
+    frame[rng() % frame[0]] ^= 1 << (rng() % 8);
+    EXPECT_FALSE(askCheckCrc(frame, frame[0]));
+  }
+}
+
+TEST(AskCodec, DecodeRejectsInvalidSymbolsAndCounts) {
+  uint8_t headers[ASK_HEADER_LEN] = {0xff, 7, 0, 0};
+  uint8_t payload[5] = {1, 2, 3, 4, 5};
+  uint8_t symbols[2 * ASK_MAX_FRAME_LEN];
+  uint8_t frame[ASK_MAX_FRAME_LEN];
+  uint8_t num_symbols = askEncode(headers, payload, sizeof(payload), symbols);
+
+  EXPECT_EQ(askDecode(symbols, num_symbols - 1, frame), 0);
+
+  uint8_t corrupt[2 * ASK_MAX_FRAME_LEN];
+  std::copy(symbols, symbols + num_symbols, corrupt);
+  corrupt[5] = 0x3f;
+  EXPECT_EQ(askDecode(corrupt, num_symbols, frame), 0);
+
+  // count byte 3 is shorter than the frame overhead
+  corrupt[0] = ask_symbols[0];
+  corrupt[1] = ask_symbols[3];
+  EXPECT_EQ(askDecode(corrupt, num_symbols, frame), 0);
+}
+
+namespace {
+
+AskTransmitter<2000, PB1> transmitter;
+std::vector<uint8_t> tx_bits;
+
+// every sleep in waitPacketSent() is ended by one bit interrupt
+void bitInterrupt() {
+  transmitter.handleTimerInterrupt();
+  tx_bits.push_back((PORTB >> PB1) & 1);
+}
+
+} // namespace
+
+TEST(AskTransmitter, ClocksOutDecodableFrame) {
+  ASSERT_TRUE(transmitter.init());
+  EXPECT_EQ(DDRB & _BV(PB1), _BV(PB1));
+  transmitter.setHeaderFrom(42);
+  transmitter.setHeaderId(3);
+
+  // 8 MHz / 2000 bit/s = 4000 cycles = 250 ticks at prescaler 16 (CS = 5)
+  uint8_t payload[] = {0x4c, 0x3a, 0x1b, 0x2c, 0x64};
+  ASSERT_TRUE(transmitter.send(payload, sizeof(payload)));
+  EXPECT_EQ(TCCR1, _BV(CTC1) | 5);
+  EXPECT_EQ(OCR1C, 249);
+  EXPECT_EQ(OCR1A, 249);
+
+  tx_bits.clear();
+  hal_sleep_hook = bitInterrupt;
+  transmitter.waitPacketSent();
+  hal_sleep_hook = nullptr;
+  EXPECT_EQ(TCCR1, 0);
+  EXPECT_EQ(transmitter.txGood(), 1);
+
+  // one interrupt per bit plus the one ending the frame with the pin low
+  size_t num_symbols = ASK_PREAMBLE_LEN + 2 * (sizeof(payload) + 7);
+  ASSERT_EQ(tx_bits.size(), 6 * num_symbols + 1);
+  EXPECT_EQ(tx_bits.back(), 0);
+
+  // symbols go out LSB first
+  std::vector<uint8_t> symbols(num_symbols);
+  for (size_t i = 0; i < 6 * num_symbols; i++)
+    symbols[i / 6] |= tx_bits[i] << (i % 6);
+  EXPECT_TRUE(std::equal(ask_preamble, ask_preamble + ASK_PREAMBLE_LEN,
+                         symbols.begin()));
+
+  uint8_t frame[ASK_MAX_FRAME_LEN];
+  uint8_t len = askDecode(symbols.data() + ASK_PREAMBLE_LEN,
+                          num_symbols - ASK_PREAMBLE_LEN, frame);
+  ASSERT_EQ(len, sizeof(payload) + ASK_FRAME_OVERHEAD);
+  EXPECT_TRUE(askCheckCrc(frame, len));
+  EXPECT_EQ(frame[1], ASK_TX_BROADCAST_ADDRESS);
+  EXPECT_EQ(frame[2], 42);
+  EXPECT_EQ(frame[3], 3);
+  EXPECT_TRUE(std::equal(payload, payload + sizeof(payload), frame + 5));
+}
+
+TEST(AskTransmitter, RejectsTooLongPayload) {
+  uint8_t payload[ASK_TX_MAX_MESSAGE_LEN + 1] = {};
+  EXPECT_FALSE(transmitter.send(payload, sizeof(payload)));
+}
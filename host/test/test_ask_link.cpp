@@ -0,0 +1,522 @@
+// RH_ASK receiver port, soft-decision receiver, edge decoder and the
+// simulated radio link
+#include "ask_edge_decoder.hpp"
+#include "ask_link.hpp"
+#include "ask_transmitter.hpp"
+#include "climate_protocol.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Frames {
+  AskWaveform waveform;
+  std::vector<AskFrame> sent;
+};
+
+Frames sendFrames(unsigned count, uint8_t len, double bit_period,
+                  std::mt19937 &rng) {
+  Frames frames;
+  std::vector<uint8_t> payload(len);
+  for (unsigned i = 0; i < count; i++) {
+    uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, uint8_t(i), 0};
+    for (uint8_t &byte : payload)
+      byte = rng();
+    frames.sent.push_back(askModulate(frames.waveform,
+                                      frames.waveform.end + 40 * bit_period,
+                                      bit_period, headers, payload.data(),
+                                      len));
+  }
+  frames.waveform.end += 40 * bit_period;
+  return frames;
+}
+
+// Pin levels of the firmware transmitter, one per bit interrupt
+std::vector<uint8_t> tx_bits;
+
+template <uint16_t Speed> struct Transmitter {
+  static AskTransmitter<Speed, PB1> transmitter;
+
+  // every sleep in waitPacketSent() is ended by one bit interrupt
+  static void bitInterrupt() {
+    transmitter.handleTimerInterrupt();
+    tx_bits.push_back((PORTB >> PB1) & 1);
+  }
+
+  // Sends frames with the firmware transmitter and returns its pin waveform,
+  // the edges at the bit period Timer1 is set up for and each late by up to
+  // the time other interrupts block the bit interrupt
+  static AskWaveform send(unsigned count, uint8_t len, std::mt19937 &rng) {
+    std::uniform_real_distribution<double> latency(
+        0, double(ASK_TX_BLOCKING_CYCLES) / F_CPU);
+    AskWaveform waveform;
+    EXPECT_TRUE(transmitter.init());
+    std::vector<uint8_t> payload(len);
+    for (unsigned i = 0; i < count; i++) {
+      for (uint8_t &byte : payload)
+        byte = rng();
+      transmitter.setHeaderId(i);
+      tx_bits.clear();
+      EXPECT_TRUE(transmitter.send(payload.data(), len));
+      double bit_period = double(OCR1C + 1) * (1 << ((TCCR1 & 0x0f) - 1)) /
+                          F_CPU;
+      EXPECT_DOUBLE_EQ(bit_period, askBitPeriod(Speed));
+      hal_sleep_hook = bitInterrupt;
+      transmitter.waitPacketSent();
+      hal_sleep_hook = nullptr;
+
+      double start = waveform.end + 40 * bit_period;
+      uint8_t level = 0;
+      for (size_t bit = 0; bit < tx_bits.size(); bit++) {
+        if (tx_bits[bit] == level)
+          continue;
+        level = tx_bits[bit];
+        waveform.times.push_back(start + bit * bit_period + latency(rng));
+        waveform.levels.push_back(level);
+      }
+      waveform.end = start + (tx_bits.size() + 40) * bit_period;
+    }
+    return waveform;
+  }
+};
+
+template <uint16_t Speed>
+AskTransmitter<Speed, PB1> Transmitter<Speed>::transmitter;
+
+// Frames of the firmware transmitter at a bit rate that arrive at a receiver
+// running at the same rate, with its clock 1% off and some noise
+template <uint16_t Speed> unsigned deliveredAt(unsigned count) {
+  std::mt19937 rng(Speed);
+  AskWaveform waveform = Transmitter<Speed>::send(count, 5, rng);
+  AskChannel channel;
+  channel.noise = 0.1;
+  channel.clock_skew = 0.01;
+  AskLinkResult result =
+      askRunLink(waveform, askBitPeriod(Speed), channel, rng);
+  // the frames carry their number in the id header
+  std::vector<bool> seen(count);
+  for (const AskFrame &frame : result.frames)
+    if (frame.bytes[3] < count)
+      seen[frame.bytes[3]] = true;
+  return std::count(seen.begin(), seen.end(), true);
+}
+
+// Frames an AskEdgeDecoder finds in the edges of a waveform
+std::vector<AskFrame> decodeEdges(const AskWaveform &waveform,
+                                  AskEdgeDecoder &decoder) {
+  std::vector<AskFrame> frames;
+  auto received = [&] {
+    frames.push_back({decoder.frameTime(),
+                      std::vector<uint8_t>(decoder.frame(),
+                                           decoder.frame() +
+                                               decoder.frameLen())});
+  };
+  for (size_t i = 0; i < waveform.times.size(); i++)
+    if (decoder.edge(waveform.times[i], waveform.levels[i]))
+      received();
+  if (decoder.idle(waveform.end))
+    received();
+  return frames;
+}
+
+} // namespace
+
+TEST(AskLink, BitPeriodMatchesTimer1) {
+  // 8 MHz / 8 / 250 ticks
+  EXPECT_DOUBLE_EQ(askBitPeriod(2000), 500e-6);
+  EXPECT_NEAR(askBitPeriod(9600), 1.0 / 9600, 0.01 / 9600);
+}
+
+TEST(AskLink, ModulatedFrameIsTheTransmitterBitstream) {
+  const uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, 2, 3};
+  const uint8_t payload[] = {0x12, 0x34, 0x56};
+  AskWaveform waveform;
+  AskFrame frame =
+      askModulate(waveform, 0, 1, headers, payload, sizeof payload);
+  ASSERT_EQ(frame.bytes.size(), sizeof payload + ASK_FRAME_OVERHEAD);
+  EXPECT_TRUE(askCheckCrc(frame.bytes.data(), frame.bytes.size()));
+
+  // preamble, symbols and the bit period to go low
+  size_t bits = 6 * (ASK_PREAMBLE_LEN + 2 * frame.bytes.size());
+  EXPECT_DOUBLE_EQ(frame.end, bits);
+  EXPECT_DOUBLE_EQ(askAirtime(sizeof payload, 1), bits);
+  EXPECT_DOUBLE_EQ(waveform.end, bits + 1);
+  EXPECT_FALSE(waveform.levels.back());
+  // the preamble 0x2a starts with a 0 bit, 0 1 0 1 ...
+  EXPECT_DOUBLE_EQ(waveform.times[0], 1);
+  EXPECT_TRUE(waveform.levels[0]);
+}
+
+TEST(AskLink, CleanChannelDeliversEveryFrame) {
+  std::mt19937 rng(1);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(200, CLIMATE_V2_PAYLOAD_LEN, bit_period, rng);
+  AskLinkResult result =
+      askRunLink(frames.waveform, bit_period, AskChannel(), rng);
+  ASSERT_EQ(result.frames.size(), frames.sent.size());
+  for (size_t i = 0; i < frames.sent.size(); i++) {
+    EXPECT_EQ(result.frames[i].bytes, frames.sent[i].bytes);
+    // the receiver decides the last bit within a sample of its end
+    EXPECT_NEAR(result.frames[i].end, frames.sent[i].end, bit_period / 8);
+  }
+  EXPECT_EQ(result.bad, 0u);
+  AskBitErrors errors = askBitErrors(frames.sent, result, bit_period);
+  EXPECT_EQ(errors.errors, 0u);
+  EXPECT_EQ(errors.bits, 8u * (CLIMATE_V2_PAYLOAD_LEN + ASK_FRAME_OVERHEAD) *
+                             frames.sent.size());
+  for (int high = 1; high < ASK_RX_SAMPLES_PER_BIT - 1; high++)
+    EXPECT_EQ(result.stats.integrator[high], 0u);
+  // sampling 8 times per bit the PLL locks within one sample
+  EXPECT_LE(result.stats.max_phase_error, ASK_RX_RAMP_INC);
+}
+
+TEST(AskLink, ToleratesClockSkew) {
+  std::mt19937 rng(2);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(100, 16, bit_period, rng);
+  for (double skew : {-0.02, 0.02}) {
+    AskChannel channel;
+    channel.clock_skew = skew;
+    AskLinkResult result =
+        askRunLink(frames.waveform, bit_period, channel, rng);
+    EXPECT_EQ(askDelivered(frames.sent, result.frames), frames.sent.size());
+    EXPECT_GT(result.stats.max_phase_error, 0);
+  }
+
+  // the PLL adjusts by 9 of 160 per transition, it loses lock far beyond that
+  AskChannel channel;
+  channel.clock_skew = 0.2;
+  AskLinkResult result = askRunLink(frames.waveform, bit_period, channel, rng);
+  EXPECT_LT(askDelivered(frames.sent, result.frames), frames.sent.size() / 2);
+}
+
+TEST(AskLink, CrcRejectsFlippedBits) {
+  std::mt19937 rng(3);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(200, 16, bit_period, rng);
+  AskChannel channel;
+  channel.flip_rate = 0.002;
+  AskLinkResult result = askRunLink(frames.waveform, bit_period, channel, rng);
+  unsigned delivered = askDelivered(frames.sent, result.frames);
+  EXPECT_LT(delivered, frames.sent.size());
+  EXPECT_GT(delivered, frames.sent.size() / 2);
+  EXPECT_GT(result.bad, 0u);
+  // nothing corrupted passes the CRC
+  EXPECT_EQ(result.frames.size(), delivered);
+  AskBitErrors errors = askBitErrors(frames.sent, result, bit_period);
+  EXPECT_GT(errors.errors, 0u);
+  EXPECT_LT(errors.errors * 100, errors.bits);
+}
+
+TEST(AskLink, EdgeTimingCostsMoreAtHigherBitRates) {
+  // 15 us edge jitter and 30 us longer pulses are a few percent of a bit at
+  // 2000 bit/s but a third of one at 9600 bit/s
+  AskChannel channel;
+  channel.edge_jitter = 15e-6;
+  channel.pulse_stretch = 30e-6;
+  unsigned delivered[2];
+  uint16_t speeds[2] = {2000, 9600};
+  for (int i = 0; i < 2; i++) {
+    std::mt19937 rng(6);
+    double bit_period = askBitPeriod(speeds[i]);
+    Frames frames = sendFrames(200, 16, bit_period, rng);
+    AskLinkResult result =
+        askRunLink(frames.waveform, bit_period, channel, rng);
+    delivered[i] = askDelivered(frames.sent, result.frames);
+  }
+  EXPECT_EQ(delivered[0], 200u);
+  EXPECT_LT(delivered[1], delivered[0]);
+}
+
+TEST(AskLink, FirmwareBitRatesReachTheReceiver) {
+  EXPECT_EQ(deliveredAt<2000>(100), 100u);
+  EXPECT_EQ(deliveredAt<4000>(100), 100u);
+  EXPECT_EQ(deliveredAt<8000>(100), 100u);
+  EXPECT_EQ(deliveredAt<9600>(100), 100u);
+}
+
+TEST(AskLink, PulseStretchSwallowsShortGaps) {
+  const uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, 2, 3};
+  AskWaveform waveform;
+  askModulate(waveform, 0, 1, headers, nullptr, 0);
+  AskChannel channel;
+  channel.pulse_stretch = 4; // longer than any run of zeros
+  std::mt19937 rng(7);
+  AskLinkResult result = askRunLink(waveform, 1, channel, rng);
+  EXPECT_TRUE(result.frames.empty());
+  EXPECT_EQ(result.stats.transitions, 0u);
+}
+
+TEST(AskLink, NoiseBetweenFramesDoesNotHideThem) {
+  std::mt19937 rng(4);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(100, 16, bit_period, rng);
+  AskChannel channel;
+  channel.noise = 0.15;
+  AskLinkResult result = askRunLink(frames.waveform, bit_period, channel, rng);
+  EXPECT_EQ(askDelivered(frames.sent, result.frames), frames.sent.size());
+  EXPECT_GT(result.stats.integrator[1] + result.stats.integrator[7], 0u);
+
+  // a receiver without carrier sees random bits
+  channel.noise = 10;
+  result = askRunLink(frames.waveform, bit_period, channel, rng);
+  EXPECT_EQ(askDelivered(frames.sent, result.frames), 0u);
+}
+
+TEST(AskLink, DropoutsLoseFrames) {
+  std::mt19937 rng(5);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(200, 16, bit_period, rng);
+  AskChannel channel;
+  channel.dropout_rate = 5;
+  channel.dropout_length = 0.005;
+  AskLinkResult result = askRunLink(frames.waveform, bit_period, channel, rng);
+  unsigned delivered = askDelivered(frames.sent, result.frames);
+  EXPECT_LT(delivered, frames.sent.size());
+  EXPECT_GT(delivered, frames.sent.size() / 4);
+
+  channel.dropout_level = 0.8; // fades that keep the signal above threshold
+  result = askRunLink(frames.waveform, bit_period, channel, rng);
+  EXPECT_EQ(askDelivered(frames.sent, result.frames), frames.sent.size());
+}
+
+TEST(AskReceiver, RejectsBadCountByte) {
+  // start symbol, then the count byte 0x03 as two symbols, LSB first
+  AskReceiver receiver;
+  std::vector<uint8_t> symbols(ask_preamble, ask_preamble + ASK_PREAMBLE_LEN);
+  symbols.push_back(ask_symbols[0x0]);
+  symbols.push_back(ask_symbols[0x3]);
+  for (uint8_t symbol : symbols)
+    for (int bit = 0; bit < 6; bit++)
+      for (int i = 0; i < ASK_RX_SAMPLES_PER_BIT; i++)
+        EXPECT_FALSE(receiver.sample(symbol & (1 << bit)));
+  EXPECT_EQ(receiver.rxBad(), 1);
+}
+
+TEST(AskSoftReceiver, AgreesWithTheReceiverOnACleanChannel) {
+  std::mt19937 rng(12);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(200, CLIMATE_V2_PAYLOAD_LEN, bit_period, rng);
+  AskSoftOptions soft;
+  AskLinkResult result =
+      askRunLink(frames.waveform, bit_period, AskChannel(), rng, &soft);
+  ASSERT_EQ(result.soft_frames.size(), frames.sent.size());
+  for (size_t i = 0; i < frames.sent.size(); i++) {
+    EXPECT_EQ(result.soft_frames[i].bytes, frames.sent[i].bytes);
+    EXPECT_EQ(result.soft_frames[i].end, result.frames[i].end);
+  }
+  EXPECT_EQ(result.soft_repaired, 0u);
+}
+
+TEST(AskSoftReceiver, RepairsWeakBits) {
+  const uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, 2, 3};
+  const uint8_t payload[5] = {0x4c, 0x3a, 0x1b, 0x2c, 0x64};
+  std::vector<uint8_t> symbols(ask_preamble, ask_preamble + ASK_PREAMBLE_LEN);
+  symbols.resize(ASK_PREAMBLE_LEN + 2 * (5 + ASK_FRAME_OVERHEAD));
+  askEncode(headers, payload, 5, symbols.data() + ASK_PREAMBLE_LEN);
+  // all samples of a bit agree, 4 or 5 of them make a weak wrong decision
+  std::vector<uint8_t> integrators;
+  for (uint8_t symbol : symbols)
+    for (int bit = 0; bit < 6; bit++)
+      integrators.push_back(symbol & (1 << bit) ? ASK_RX_SAMPLES_PER_BIT : 0);
+  auto weaken = [&](size_t bit) {
+    integrators[bit] = integrators[bit] ? ASK_RX_ONE_THRESHOLD - 1
+                                        : ASK_RX_ONE_THRESHOLD;
+  };
+  // a bit of the start symbol, an invalid symbol in the headers and a
+  // payload symbol turned into another valid one
+  weaken(6 * (ASK_PREAMBLE_LEN - 1) + 2);
+  weaken(6 * (ASK_PREAMBLE_LEN + 4));
+  size_t symbol = ASK_PREAMBLE_LEN + 2 * (1 + ASK_HEADER_LEN) + 3;
+  uint8_t flipped = 0;
+  for (int one = 0; one < 6 && !flipped; one++)
+    for (int zero = 0; zero < 6 && !flipped; zero++) {
+      uint8_t other = symbols[symbol] ^ (1 << one | 1 << zero);
+      if ((symbols[symbol] & (1 << one)) && !(symbols[symbol] & (1 << zero)) &&
+          askDecodeSymbol(other) != ASK_INVALID_SYMBOL) {
+        weaken(6 * symbol + one);
+        weaken(6 * symbol + zero);
+        flipped = other;
+      }
+    }
+  ASSERT_TRUE(flipped);
+
+  AskReceiver receiver;
+  AskSoftReceiver soft;
+  bool received = false;
+  for (uint8_t integrator : integrators) {
+    EXPECT_FALSE(receiver.bit(integrator >= ASK_RX_ONE_THRESHOLD));
+    received = soft.bit(integrator);
+  }
+  ASSERT_TRUE(received);
+  uint8_t frame[ASK_MAX_FRAME_LEN];
+  ASSERT_EQ(soft.frameLen(),
+            askDecode(symbols.data() + ASK_PREAMBLE_LEN,
+                      symbols.size() - ASK_PREAMBLE_LEN, frame));
+  EXPECT_TRUE(std::equal(frame, frame + soft.frameLen(), soft.frame()));
+  EXPECT_EQ(soft.rxGood(), 1u);
+  EXPECT_EQ(soft.rxRepaired(), 1u);
+}
+
+TEST(AskSoftReceiver, RecoversFramesAtTheEdgeOfRange) {
+  std::mt19937 rng(13);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(500, 16, bit_period, rng);
+  AskChannel channel;
+  channel.noise = 0.3;
+  AskSoftOptions soft;
+  AskLinkResult result =
+      askRunLink(frames.waveform, bit_period, channel, rng, &soft);
+  unsigned hard = askDelivered(frames.sent, result.frames);
+  unsigned repaired = askDelivered(frames.sent, result.soft_frames);
+  EXPECT_LT(hard, 400u);
+  EXPECT_GT(repaired, hard + 100);
+  EXPECT_GE(result.soft_repaired, repaired - hard);
+  // nothing corrupted passes
+  EXPECT_EQ(result.soft_frames.size(), repaired);
+}
+
+TEST(AskEdgeDecoder, DecodesEveryFrame) {
+  std::mt19937 rng(8);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(50, 16, bit_period, rng);
+  AskEdgeDecoder decoder(bit_period);
+  std::vector<AskFrame> received = decodeEdges(frames.waveform, decoder);
+  ASSERT_EQ(received.size(), 50u);
+  EXPECT_EQ(askDelivered(frames.sent, received), 50u);
+  for (size_t i = 0; i < received.size(); i++)
+    EXPECT_NEAR(received[i].end, frames.sent[i].end, bit_period / 8);
+  EXPECT_EQ(decoder.rxBad(), 0);
+}
+
+TEST(AskEdgeDecoder, IdleEndsAFrameWithoutFinalEdge) {
+  // payload chosen so that the CRC ends in low bits
+  const uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, 2, 3};
+  std::mt19937 rng(9);
+  for (int i = 0; i < 20; i++) {
+    uint8_t payload[4] = {uint8_t(rng()), uint8_t(rng()), uint8_t(rng()),
+                          uint8_t(rng())};
+    AskWaveform waveform;
+    askModulate(waveform, 0, 1, headers, payload, sizeof payload);
+    if (waveform.times.back() == waveform.end - 1)
+      continue; // the frame ends high, its falling edge is the last bit
+    AskEdgeDecoder decoder(1);
+    for (size_t edge = 0; edge < waveform.times.size(); edge++)
+      EXPECT_FALSE(decoder.edge(waveform.times[edge], waveform.levels[edge]));
+    EXPECT_TRUE(decoder.active());
+    EXPECT_TRUE(decoder.idle(waveform.end + 1));
+    return;
+  }
+  FAIL() << "no frame ending low";
+}
+
+TEST(AskEdgeDecoder, ToleratesJitterAndClockSkewBeyondThePll) {
+  // edges up to an eighth of a bit off and a 4% clock error, more than the 8
+  // sample PLL of RH_ASK tolerates (see ToleratesClockSkew)
+  std::mt19937 rng(10);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(50, 16, bit_period, rng);
+  std::uniform_real_distribution<double> jitter(-bit_period / 8,
+                                                bit_period / 8);
+  for (double &time : frames.waveform.times)
+    time = (time + jitter(rng)) * 1.04;
+  frames.waveform.end *= 1.04;
+  AskEdgeDecoder decoder(bit_period);
+  EXPECT_EQ(askDelivered(frames.sent, decodeEdges(frames.waveform, decoder)),
+            50u);
+}
+
+TEST(AskEdgeDecoder, FitsTheBitRateOfEachFrame) {
+  // stations whose RC oscillators are 12% slow, 10% fast and 5% slow take
+  // turns, far beyond what rounding runs to the nominal bit period tolerates
+  std::mt19937 rng(14);
+  double bit_period = askBitPeriod(2000);
+  const double offsets[3] = {-0.12, 0.10, -0.05};
+  AskWaveform waveform;
+  std::vector<AskFrame> sent;
+  std::vector<uint8_t> payload(16);
+  for (int i = 0; i < 60; i++) {
+    uint8_t headers[ASK_HEADER_LEN] = {0xff, uint8_t(i % 3), uint8_t(i), 0};
+    for (uint8_t &byte : payload)
+      byte = rng();
+    sent.push_back(askModulate(waveform, waveform.end + 40 * bit_period,
+                               bit_period / (1 + offsets[i % 3]), headers,
+                               payload.data(), payload.size()));
+  }
+
+  // edges up to an eighth of a bit off, pulses 30 us longer
+  std::uniform_real_distribution<double> jitter(-bit_period / 8,
+                                                bit_period / 8);
+  AskEdgeDecoder decoder(bit_period);
+  std::vector<AskFrame> received;
+  auto receive = [&] {
+    received.push_back({decoder.frameTime(),
+                        std::vector<uint8_t>(decoder.frame(),
+                                             decoder.frame() +
+                                                 decoder.frameLen())});
+    EXPECT_NEAR(decoder.frameRateOffset(), offsets[decoder.frame()[2]],
+                0.002);
+  };
+  for (size_t i = 0; i < waveform.times.size(); i++) {
+    double time = waveform.times[i] + jitter(rng);
+    if (!waveform.levels[i])
+      time += 30e-6;
+    if (decoder.edge(time, waveform.levels[i]))
+      receive();
+  }
+  if (decoder.idle(waveform.end + 40 * bit_period))
+    receive();
+  EXPECT_EQ(askDelivered(sent, received), 60u);
+  EXPECT_EQ(decoder.rxBad(), 0);
+}
+
+TEST(AskEdgeDecoder, DropsGlitchesAndNoiseBetweenFrames) {
+  std::mt19937 rng(11);
+  double bit_period = askBitPeriod(2000);
+  Frames frames = sendFrames(50, 16, bit_period, rng);
+
+  // an eighth of a bit inverted every 20 bits on average inside frames, and
+  // random levels changing every 2 bits on average between them
+  std::exponential_distribution<double> glitch_gap(1 / (20 * bit_period));
+  std::exponential_distribution<double> noise_gap(1 / (2 * bit_period));
+  AskWaveform noisy;
+  auto add = [&](double time, bool level) {
+    noisy.times.push_back(time);
+    noisy.levels.push_back(level);
+  };
+  double next_glitch = glitch_gap(rng);
+  size_t frame = 0;
+  bool level = false;
+  for (size_t i = 0; i < frames.waveform.times.size(); i++) {
+    double time = frames.waveform.times[i];
+    bool in_frame = frame < frames.sent.size() &&
+                    time > frames.sent[frame].end - askAirtime(16, bit_period);
+    if (!in_frame) {
+      // noise from the end of the last frame up to the start of this one
+      double noise = i ? frames.waveform.times[i - 1] + 2 * bit_period : 0;
+      for (noise += noise_gap(rng); noise < time - 2 * bit_period;
+           noise += noise_gap(rng))
+        add(noise, level = !level);
+      if (level)
+        add(time - bit_period, level = false);
+    }
+    for (; next_glitch < time; next_glitch += glitch_gap(rng)) {
+      if (!in_frame || next_glitch + bit_period / 8 >= time)
+        continue;
+      add(next_glitch, !level);
+      add(next_glitch + bit_period / 8, level);
+    }
+    add(time, level = frames.waveform.levels[i]);
+    if (frame < frames.sent.size() && time >= frames.sent[frame].end)
+      frame++;
+  }
+  noisy.end = frames.waveform.end;
+
+  AskEdgeDecoder decoder(bit_period);
+  EXPECT_EQ(askDelivered(frames.sent, decodeEdges(noisy, decoder)), 50u);
+  EXPECT_GT(decoder.glitches(), 50u);
+}
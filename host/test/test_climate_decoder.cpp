@@ -0,0 +1,146 @@
+// Receiver side decoding of all payload formats
+#include "climate_decoder.hpp"
+#include "climate_protocol.hpp"
+#include "tdma_schedule.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+TEST(ClimateDecoder, V1Struct) {
+  // DataPackage of the firmware: two little endian floats, battery, station
+  uint8_t payload[10];
+  float temperature = 21.5f, humidity = 48.25f;
+  std::memcpy(payload, &temperature, 4);
+  std::memcpy(payload + 4, &humidity, 4);
+  payload[8] = 87;
+  payload[9] = 5;
+
+  std::vector<Measurement> measurements;
+  ASSERT_TRUE(decodePayload(0xff, payload, sizeof(payload), 100, measurements));
+  ASSERT_EQ(measurements.size(), 1u);
+  EXPECT_EQ(measurements[0].format, CLIMATE_FORMAT_V1);
+  EXPECT_EQ(measurements[0].station_id, 5);
+  EXPECT_EQ(measurements[0].battery, 87);
+  EXPECT_FLOAT_EQ(measurements[0].temperature, 21.5);
+  EXPECT_FLOAT_EQ(measurements[0].humidity, 48.25);
+}
+
+TEST(ClimateDecoder, V2Sample) {
+  uint8_t payload[CLIMATE_V2_PAYLOAD_LEN];
+  // 25 degC and 50 %RH as 14 bit codes
+  climatePackV2(ClimateSample{6454, 8192, climateBatteryVoltage(3600)},
+                payload);
+
+  std::vector<Measurement> measurements;
+  ASSERT_TRUE(decodePayload(7, payload, sizeof(payload), 100, measurements));
+  ASSERT_EQ(measurements.size(), 1u);
+  EXPECT_EQ(measurements[0].station_id, 7);
+  EXPECT_NEAR(measurements[0].temperature, 25.0, 0.01);
+  EXPECT_NEAR(measurements[0].humidity, 50.0, 0.01);
+  EXPECT_EQ(measurements[0].battery_mv, 3600);
+  EXPECT_EQ(measurements[0].battery, 0);
+  EXPECT_EQ(measurements[0].timestamp, 100);
+}
+
+TEST(ClimateDecoder, V3TimestampsBackwards) {
+  ClimateBatchSample samples[3] = {{6454, 8192, 0}, {6460, 8190, 7}, {6470, 8180, 2}};
+  uint8_t payload[CLIMATE_BATCH_MAX_LEN(3)];
+  uint8_t len = climatePackBatch(samples, 3, 90, payload);
+
+  std::vector<Measurement> measurements;
+  ASSERT_TRUE(decodePayload(3, payload, len, 1000, measurements, 8.0));
+  ASSERT_EQ(measurements.size(), 3u);
+  EXPECT_EQ(measurements[2].timestamp, 1000);
+  EXPECT_EQ(measurements[1].timestamp, 1000 - 2 * 8.0);
+  EXPECT_EQ(measurements[0].timestamp, 1000 - 9 * 8.0);
+  EXPECT_EQ(measurements[0].battery, 90);
+}
+
+TEST(ClimateDecoder, V3TimestampsWithSlotStretch) {
+  // station 13 sleeps its TDMA stretch on top of every sleep cycle and does
+  // not batch every sample, the offsets have to carry the stretch of all the
+  // cycles in between
+  const uint16_t wakeup_ms = 8000;
+  const uint32_t stretch_ms =
+      tdmaStretchTicks(13, tdmaSlotTicks(tdmaAirtimeMs(
+                               CLIMATE_BATCH_MAX_LEN(4), 2000))) *
+      TDMA_TICK_MS;
+  ASSERT_GT(stretch_ms, 0u);
+  const uint8_t cycle_wakeups[] = {1, 1, 2, 1, 4, 1, 1, 3, 1, 2, 1, 1};
+  const bool batched[] = {true, false, true, false, false, true,
+                          false, true, false, false, true, true};
+
+  ClimateBatchSample samples[6];
+  double sample_ms[6];
+  uint8_t count = 0;
+  int32_t elapsed_ms = 0;
+  double now_ms = 0;
+  for (size_t i = 0; i < sizeof(cycle_wakeups); i++) {
+    if (batched[i]) {
+      samples[count] = {uint16_t(6454 + count), 8192,
+                        climateBatchOffset(&elapsed_ms, wakeup_ms)};
+      sample_ms[count++] = now_ms;
+    }
+    uint32_t sleep_ms = cycle_wakeups[i] * wakeup_ms + stretch_ms;
+    elapsed_ms += sleep_ms;
+    now_ms += sleep_ms;
+  }
+  ASSERT_EQ(count, 6);
+  uint8_t payload[CLIMATE_BATCH_MAX_LEN(6)];
+  uint8_t len = climatePackBatch(samples, count, 90, payload);
+
+  std::vector<Measurement> measurements;
+  ASSERT_TRUE(decodePayload(3, payload, len, 1000, measurements, 8.0));
+  ASSERT_EQ(measurements.size(), count);
+  for (uint8_t i = 0; i < count; i++) {
+    double expected = 1000 - (sample_ms[count - 1] - sample_ms[i]) / 1000;
+    EXPECT_NEAR(measurements[i].timestamp, expected, 8.0) << "sample " << +i;
+  }
+}
+
+TEST(ClimateDecoder, BatchOffsetSaturates) {
+  int32_t elapsed_ms = 300 * 8000;
+  EXPECT_EQ(climateBatchOffset(&elapsed_ms, 8000), 255);
+  EXPECT_EQ(elapsed_ms, 0);
+  elapsed_ms = 8000 + 4100;
+  EXPECT_EQ(climateBatchOffset(&elapsed_ms, 8000), 2);
+  EXPECT_EQ(elapsed_ms, -3900);
+}
+
+TEST(ClimateDecoder, V3NotTakenForV1ByLength) {
+  // unpadded these batches are 11 (3 samples, 5 and 4 bit deltas) and 10
+  // bytes long (4 samples, flat), the lengths of format 1 payloads
+  ClimateBatchSample deltas[3] = {
+      {6454, 8192, 0}, {6469, 8199, 1}, {6440, 8185, 1}};
+  ClimateBatchSample flat[4] = {
+      {6454, 8192, 0}, {6454, 8192, 1}, {6454, 8192, 1}, {6454, 8192, 1}};
+  struct {
+    const ClimateBatchSample *samples;
+    uint8_t count;
+  } batches[] = {{deltas, 3}, {flat, 4}};
+  for (const auto &batch : batches) {
+    uint8_t payload[CLIMATE_BATCH_MAX_LEN(4)];
+    uint8_t len = climatePackBatch(batch.samples, batch.count, 90, payload);
+    EXPECT_EQ(len, CLIMATE_V1_STACK_COUNTING_PAYLOAD_LEN + 1);
+
+    std::vector<Measurement> measurements;
+    ASSERT_TRUE(decodePayload(3, payload, len, 1000, measurements, 8.0));
+    ASSERT_EQ(measurements.size(), batch.count);
+    for (uint8_t i = 0; i < batch.count; i++) {
+      EXPECT_EQ(measurements[i].format, CLIMATE_FORMAT_V3);
+      EXPECT_EQ(measurements[i].temperature,
+                hdc1080Temperature(batch.samples[i].temperature));
+      EXPECT_EQ(measurements[i].humidity,
+                hdc1080Humidity(batch.samples[i].humidity));
+    }
+  }
+}
+
+TEST(ClimateDecoder, RejectsUnknownPayloads) {
+  std::vector<Measurement> measurements;
+  uint8_t unknown[5] = {0xe0, 0, 0, 0, 0}; // format tag 7
+  EXPECT_FALSE(decodePayload(1, unknown, sizeof(unknown), 0, measurements));
+  EXPECT_FALSE(decodePayload(1, unknown, 0, 0, measurements));
+  EXPECT_TRUE(measurements.empty());
+}
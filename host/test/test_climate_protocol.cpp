@@ -0,0 +1,84 @@
+// Bit-packed payload formats, drift and battery encodings
+#include "climate_protocol.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+TEST(ClimateProtocol, V2Roundtrip) {
+  std::mt19937 rng(2);
+  for (int i = 0; i < 10000; i++) {
+    ClimateSample sample{uint16_t(rng() & 0x3fff), uint16_t(rng() & 0x3fff),
+                         uint8_t(rng() & 0xff)};
+    if (!(sample.battery & CLIMATE_BATTERY_VOLTAGE))
+      sample.battery %= 101;
+    uint8_t buf[CLIMATE_V2_PAYLOAD_LEN];
+    ASSERT_EQ(climatePackV2(sample, buf), CLIMATE_V2_PAYLOAD_LEN);
+    EXPECT_EQ(climateFormatTag(buf), CLIMATE_FORMAT_V2);
+
+    ClimateSample unpacked;
+    ASSERT_TRUE(climateUnpackV2(buf, sizeof(buf), &unpacked));
+    EXPECT_EQ(unpacked.temperature, sample.temperature);
+    EXPECT_EQ(unpacked.humidity, sample.humidity);
+    EXPECT_EQ(unpacked.battery, sample.battery);
+  }
+}
+
+TEST(ClimateProtocol, V2RejectsShortPayload) {
+  uint8_t buf[CLIMATE_V2_PAYLOAD_LEN];
+  climatePackV2(ClimateSample{1, 2, 3}, buf);
+  ClimateSample unpacked;
+  EXPECT_FALSE(climateUnpackV2(buf, sizeof(buf) - 1, &unpacked));
+}
+
+TEST(ClimateProtocol, BatchRoundtrip) {
+  std::mt19937 rng(3);
+  for (int i = 0; i < 10000; i++) {
+    uint8_t count = 1 + rng() % CLIMATE_BATCH_MAX_SAMPLES;
+    // small walks most of the time, full range jumps now and then
+    int spread = i % 10 ? 64 : 0x4000;
+    ClimateBatchSample samples[CLIMATE_BATCH_MAX_SAMPLES];
+    samples[0] = {uint16_t(rng() & 0x3fff), uint16_t(rng() & 0x3fff), 0};
+    for (uint8_t j = 1; j < count; j++) {
+      samples[j].temperature =
+          (samples[0].temperature + rng() % spread - spread / 2) & 0x3fff;
+      samples[j].humidity =
+          (samples[0].humidity + rng() % spread - spread / 2) & 0x3fff;
+      samples[j].offset = rng();
+    }
+    uint8_t battery = rng() % 101;
+
+    uint8_t buf[CLIMATE_BATCH_MAX_LEN(CLIMATE_BATCH_MAX_SAMPLES)];
+    uint8_t len = climatePackBatch(samples, count, battery, buf);
+    ASSERT_LE(len, CLIMATE_BATCH_MAX_LEN(count));
+    ASSERT_NE(len, CLIMATE_V1_PAYLOAD_LEN);
+    ASSERT_NE(len, CLIMATE_V1_STACK_COUNTING_PAYLOAD_LEN);
+
+    ClimateBatchSample unpacked[CLIMATE_BATCH_MAX_SAMPLES];
+    uint8_t unpacked_count, unpacked_battery;
+    ASSERT_TRUE(climateUnpackBatch(buf, len, unpacked, &unpacked_count,
+                                   &unpacked_battery));
+    ASSERT_EQ(unpacked_count, count);
+    EXPECT_EQ(unpacked_battery, battery);
+    for (uint8_t j = 0; j < count; j++) {
+      EXPECT_EQ(unpacked[j].temperature, samples[j].temperature);
+      EXPECT_EQ(unpacked[j].humidity, samples[j].humidity);
+      EXPECT_EQ(unpacked[j].offset, samples[j].offset);
+    }
+  }
+}
+
+TEST(ClimateProtocol, BatteryVoltage) {
+  EXPECT_EQ(climateBatteryMillivolts(100), 0);
+  EXPECT_EQ(climateBatteryMillivolts(climateBatteryVoltage(3540)), 3540);
+  EXPECT_EQ(climateBatteryMillivolts(climateBatteryVoltage(3555)), 3540);
+  EXPECT_EQ(climateBatteryMillivolts(climateBatteryVoltage(1000)), 1800);
+  EXPECT_EQ(climateBatteryMillivolts(climateBatteryVoltage(5000)), 4340);
+}
+
+TEST(ClimateProtocol, WatchdogDrift) {
+  EXPECT_EQ(climateUnpackDrift(climatePackDrift(CLIMATE_WATCHDOG_TICK_US)), 0);
+  EXPECT_EQ(climateUnpackDrift(climatePackDrift(17600)), 100);
+  EXPECT_EQ(climateUnpackDrift(climatePackDrift(14400)), -100);
+  EXPECT_EQ(climateUnpackDrift(climatePackDrift(30000)), 127);
+}
@@ -0,0 +1,69 @@
+// Integer sensor conversions, send policy and transmit schedule of the station
+#include "hdc1080_driver.hpp"
+#include "send_policy.hpp"
+#include "tdma_schedule.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <set>
+
+TEST(Hdc1080, FixedPointConversionsWithinOneDigit) {
+  for (uint32_t raw = 0; raw <= 0xffff; raw += 4) {
+    double temperature = raw / 65536.0 * 165 - 40;
+    double humidity = raw / 65536.0 * 100;
+    ASSERT_NEAR(HDC1080I2CDriver::toCentiCelsius(raw) / 100.0, temperature,
+                0.01);
+    ASSERT_NEAR(HDC1080I2CDriver::toCentiPercent(raw) / 100.0, humidity, 0.01);
+  }
+}
+
+TEST(SendPolicy, SendsFirstSampleThenOnlyChanges) {
+  SendPolicy policy;
+  EXPECT_TRUE(policy.update(6000, 8000, 0));
+  EXPECT_EQ(policy.interval(), SEND_POLICY_START_INTERVAL);
+  EXPECT_FALSE(policy.update(6001, 8001, policy.interval()));
+  EXPECT_TRUE(policy.update(6000 + SEND_POLICY_TEMPERATURE_DEADBAND, 8001,
+                            policy.interval()));
+  EXPECT_TRUE(policy.update(6000 + SEND_POLICY_TEMPERATURE_DEADBAND,
+                            8000 + SEND_POLICY_HUMIDITY_DEADBAND + 1,
+                            policy.interval()));
+}
+
+TEST(SendPolicy, HeartbeatAndCadence) {
+  SendPolicy policy;
+  policy.update(6000, 8000, 0);
+
+  // a stable climate stretches the cadence and is sent once per heartbeat
+  unsigned wakeups = 0, last_sent = 0;
+  for (int i = 0; i < 200; i++) {
+    uint8_t interval = policy.interval();
+    wakeups += interval;
+    if (policy.update(6000, 8000, interval)) {
+      EXPECT_GE(wakeups - last_sent, unsigned(SEND_POLICY_HEARTBEAT));
+      EXPECT_LT(wakeups - last_sent,
+                unsigned(SEND_POLICY_HEARTBEAT + SEND_POLICY_MAX_INTERVAL));
+      last_sent = wakeups;
+    }
+  }
+  EXPECT_EQ(policy.interval(), SEND_POLICY_MAX_INTERVAL);
+  EXPECT_GT(last_sent, 0u);
+
+  // a fast change shortens it down to the minimum
+  for (int i = 1; i < 10; i++)
+    policy.update(6000 + i * SEND_POLICY_TEMPERATURE_DEADBAND, 8000,
+                  policy.interval());
+  EXPECT_EQ(policy.interval(), SEND_POLICY_MIN_INTERVAL);
+}
+
+TEST(TdmaSchedule, DistinctSlotsAndAirtime) {
+  std::set<uint16_t> stretches;
+  for (unsigned id = 0; id < TDMA_SLOTS; id++)
+    stretches.insert(tdmaStretchTicks(id, 13));
+  EXPECT_EQ(stretches.size(), size_t(TDMA_SLOTS));
+  EXPECT_EQ(tdmaSlot(TDMA_SLOTS + 3), 3);
+
+  // 5 byte payload: 32 symbols of 6 bits at 2000 bit/s
+  EXPECT_EQ(tdmaAirtimeMs(5, 2000), 96);
+  EXPECT_EQ(tdmaSlotTicks(96), 13);
+}
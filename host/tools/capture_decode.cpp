@@ -0,0 +1,147 @@
+// Decodes RH_ASK frames from a raw sample capture of the receiver output:
+//
+//   capture_decode [-s speed] [-r sample_rate] [-c channel] [-b]
+//                  [-t start_time] [-j threads] capture
+//
+// The capture holds one sample per byte with the receiver output in bit -c
+// (sigrok-cli -O binary of a logic analyser), or 8 samples per byte LSB first
+// with -b. It is sampled at -r Hz, a multiple of 8 samples per bit of -s bit/s
+// (the default). The file is memory mapped and decoded by up to -j threads,
+// all cores by default, see askDecodeCapture().
+//
+// Prints the good frames in the input format of climate_decode:
+//
+//   <from header> <payload hex> <time in s> <id header>
+//
+// with the time counted from -t, and to stderr the frames per station, the
+// frames validateRxBuf() would count as bad (count byte or CRC) and the
+// decoding speed.
+#include "ask_capture.hpp"
+#include "ask_codec.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr, "usage: capture_decode [-s speed] [-r sample_rate] "
+                       "[-c channel] [-b] [-t start_time] [-j threads] "
+                       "capture\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned speed = 2000;
+  double sample_rate = 0;
+  double start_time = 0;
+  unsigned threads = std::thread::hardware_concurrency();
+  AskCaptureFormat format;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:r:c:bt:j:")) != -1) {
+    switch (opt) {
+    case 's':
+      speed = std::atoi(optarg);
+      break;
+    case 'r':
+      sample_rate = std::atof(optarg);
+      break;
+    case 'c':
+      format.channel = std::atoi(optarg);
+      break;
+    case 'b':
+      format.packed = true;
+      break;
+    case 't':
+      start_time = std::atof(optarg);
+      break;
+    case 'j':
+      threads = std::atoi(optarg);
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind + 1 != argc || !speed || format.channel > 7) {
+    usage();
+    return 2;
+  }
+
+  // samples per second after decimation, 8 per bit
+  double bit_rate_samples = 8.0 * speed;
+  if (!sample_rate)
+    sample_rate = bit_rate_samples;
+  format.decimation = std::lround(sample_rate / bit_rate_samples);
+  if (format.decimation < 1 ||
+      std::abs(format.decimation * bit_rate_samples - sample_rate) > 1e-6 ||
+      (format.packed && format.decimation != 1)) {
+    std::fprintf(stderr, "sample rate must be a multiple of 8 samples per "
+                         "bit, %.0f Hz for packed captures\n",
+                 bit_rate_samples);
+    return 2;
+  }
+
+  const char *path = argv[optind];
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    std::perror(path);
+    return 1;
+  }
+  if (st.st_size == 0) {
+    std::fprintf(stderr, "%s: empty capture\n", path);
+    return 1;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    std::perror("mmap");
+    return 1;
+  }
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+  auto started = std::chrono::steady_clock::now();
+  AskCaptureResult result = askDecodeCapture(
+      static_cast<const uint8_t *>(data), st.st_size, format, threads);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - started)
+                       .count();
+
+  std::map<unsigned, unsigned> stations;
+  for (const AskCaptureFrame &frame : result.frames) {
+    const uint8_t *headers = frame.bytes.data() + 1;
+    std::printf("%u ", headers[1]);
+    for (size_t i = 1 + ASK_HEADER_LEN; i + 2 < frame.bytes.size(); i++)
+      std::printf("%02x", frame.bytes[i]);
+    std::printf(" %.3f %u\n", start_time + frame.sample / bit_rate_samples,
+                headers[2]);
+    stations[headers[1]]++;
+  }
+
+  for (const auto &station : stations)
+    std::fprintf(stderr, "station %u: %u frames\n", station.first,
+                 station.second);
+  double capture_hours = result.samples / bit_rate_samples / 3600;
+  std::fprintf(stderr, "%zu good frames, %llu dropped for their count byte, "
+                       "%llu for their CRC\n",
+               result.frames.size(), (unsigned long long)result.bad_count,
+               (unsigned long long)result.bad_crc);
+  std::fprintf(stderr, "%.2f h of capture in %.2f s on %u threads, %.0f times "
+                       "real time, %.0f Msamples/s\n",
+               capture_hours, seconds, result.threads,
+               capture_hours * 3600 / seconds,
+               result.samples * format.decimation / seconds / 1e6);
+  munmap(data, st.st_size);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,66 @@
+// Decodes station payloads given as hex strings, one per line:
+//
+//   <from header> <payload hex> [<receive time in s> [<id header>]]
+//
+// e.g. "7 4c3a1b2c64" and prints the measurements in physical units. Batched
+// payloads print one line per sample with its reconstructed timestamp. The
+// watchdog drift the station reports in the ID header is printed if given.
+#include "climate_decoder.hpp"
+#include "climate_protocol.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool parseHex(const std::string &hex, std::vector<uint8_t> &bytes) {
+  if (hex.size() % 2)
+    return false;
+  bytes.clear();
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    unsigned value;
+    if (std::sscanf(hex.c_str() + i, "%2x", &value) != 1)
+      return false;
+    bytes.push_back(value);
+  }
+  return true;
+}
+
+int main() {
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::istringstream fields(line);
+    unsigned from;
+    std::string hex;
+    double rx_time = 0;
+    unsigned id_header = 0;
+    std::vector<uint8_t> payload;
+    std::vector<Measurement> measurements;
+
+    if (!(fields >> from >> hex) || !parseHex(hex, payload)) {
+      std::cerr << "cannot parse: " << line << "\n";
+      continue;
+    }
+    fields >> rx_time >> id_header;
+    if (!decodePayload(from, payload.data(), payload.size(), rx_time,
+                       measurements)) {
+      std::cerr << "cannot decode: " << line << "\n";
+      continue;
+    }
+    for (const Measurement &measurement : measurements) {
+      std::printf("station %u format %u at %.0f s: %.2f C %.2f %%RH battery ",
+                  measurement.station_id, measurement.format,
+                  measurement.timestamp, measurement.temperature,
+                  measurement.humidity);
+      if (measurement.battery_mv)
+        std::printf("%u mV\n", measurement.battery_mv);
+      else
+        std::printf("%u%%\n", measurement.battery);
+    }
+    if (id_header)
+      std::printf("station %u watchdog drift %+.1f%%\n", from,
+                  climateUnpackDrift(id_header) / 10.0);
+  }
+  return 0;
+}
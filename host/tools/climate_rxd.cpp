@@ -0,0 +1,448 @@
+// Receiver daemon: demodulates the RH_ASK frames of the stations from the
+// edges of one or more radio receivers and forwards the measurements:
+//
+//   climate_rxd [-s speed] [-g host[:port]] [-p prefix] [-n id=name]...
+//               input...
+//
+// An input is the GPIO line the data pin of a receiver is connected to, as
+// chip:line (gpiochip0:17 or /dev/gpiochip0:17), or a file or pipe ("-" for
+// stdin) of "time_us level" lines as energy_profile -w writes them, for tests.
+// The kernel timestamps the edges of GPIO lines (character device uapi v2) and
+// queues them, so the daemon sleeps in epoll until edges arrive instead of
+// sampling the lines. All inputs share one thread, each has its own
+// AskEdgeDecoder.
+//
+// Prints the measurements like climate_decode. -g also sends them to the
+// plaintext port of Graphite (2003 by default) as <prefix><name>.temperature,
+// .humidity and .battery (.battery_mv for stations reporting their voltage),
+// the name is station<id> unless -n gives one, and the bit rate offset of the
+// station in percent as .rate_offset. The RC oscillators of the stations
+// drift with temperature, see AskEdgeDecoder. Prints the frame counts of
+// every input and the bit rate offsets of every station when all inputs ended
+// or on SIGINT/SIGTERM.
+#include "ask_edge_decoder.hpp"
+#include "ask_link.hpp"
+#include "climate_decoder.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <map>
+#include <memory>
+#include <netdb.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// edges the kernel queues per line, about 10 frames at 5 byte payloads
+constexpr uint32_t GPIO_EVENT_BUFFER = 1024;
+
+// bit periods without an edge after which a frame in progress is completed
+constexpr double IDLE_BITS = 2;
+
+volatile sig_atomic_t stop = 0;
+
+void onSignal(int) { stop = 1; }
+
+double clockSeconds(clockid_t clock) {
+  timespec now;
+  clock_gettime(clock, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+struct Input {
+  Input(const std::string &name, double bit_period)
+      : name(name), decoder(bit_period) {}
+
+  std::string name;
+  int fd = -1;
+  bool gpio = false;
+  AskEdgeDecoder decoder;
+  uint64_t frames = 0;
+  // GPIO lines: sequence number of the last edge and edges the kernel dropped
+  uint32_t seqno = 0;
+  uint64_t lost = 0;
+  // text inputs: the incomplete last line and the time of the last edge
+  std::string line;
+  double time = 0;
+};
+
+// Sends lines to the Graphite plaintext port, connecting on demand. A failed
+// send drops its lines and reconnects with the next one.
+class Graphite {
+public:
+  bool configure(const std::string &address) {
+    size_t colon = address.rfind(':');
+    _host = address.substr(0, colon);
+    _port = colon == std::string::npos ? "2003" : address.substr(colon + 1);
+    return !_host.empty() && !_port.empty();
+  }
+
+  bool enabled() const { return !_host.empty(); }
+
+  void send(const std::string &lines) {
+    if (_fd < 0 && !connect())
+      return;
+    if (::send(_fd, lines.data(), lines.size(), MSG_NOSIGNAL) !=
+        ssize_t(lines.size())) {
+      std::fprintf(stderr, "graphite %s:%s: %s\n", _host.c_str(),
+                   _port.c_str(), std::strerror(errno));
+      close(_fd);
+      _fd = -1;
+    }
+  }
+
+private:
+  bool connect() {
+    addrinfo hints = {};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses;
+    int error = getaddrinfo(_host.c_str(), _port.c_str(), &hints, &addresses);
+    if (error) {
+      std::fprintf(stderr, "graphite %s: %s\n", _host.c_str(),
+                   gai_strerror(error));
+      return false;
+    }
+    for (addrinfo *address = addresses; address && _fd < 0;
+         address = address->ai_next) {
+      _fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC,
+                   address->ai_protocol);
+      if (_fd >= 0 && ::connect(_fd, address->ai_addr, address->ai_addrlen)) {
+        close(_fd);
+        _fd = -1;
+      }
+    }
+    freeaddrinfo(addresses);
+    if (_fd < 0)
+      std::fprintf(stderr, "graphite %s:%s: cannot connect\n", _host.c_str(),
+                   _port.c_str());
+    return _fd >= 0;
+  }
+
+  std::string _host, _port;
+  int _fd = -1;
+};
+
+// bit rate offsets of the frames of a station
+struct RateOffsets {
+  uint64_t frames = 0;
+  double sum = 0;
+  double min = 0;
+  double max = 0;
+
+  void add(double offset) {
+    min = frames ? std::min(min, offset) : offset;
+    max = frames ? std::max(max, offset) : offset;
+    sum += offset;
+    frames++;
+  }
+};
+
+struct Output {
+  Graphite graphite;
+  std::string prefix;
+  std::map<unsigned, std::string> names;
+  std::map<unsigned, RateOffsets> rate_offsets;
+
+  std::string name(unsigned station_id) const {
+    auto name = names.find(station_id);
+    return name != names.end() ? name->second
+                               : "station" + std::to_string(station_id);
+  }
+};
+
+// Decodes the last frame of an input, received at rx_time (Unix time for GPIO
+// lines, the time of the file for text inputs)
+void received(Input &input, double rx_time, Output &output) {
+  input.frames++;
+  const uint8_t *frame = input.decoder.frame();
+  uint8_t from = frame[2];
+  std::vector<Measurement> measurements;
+  if (!decodePayload(from, frame + 1 + ASK_HEADER_LEN,
+                     input.decoder.frameLen() - ASK_FRAME_OVERHEAD, rx_time,
+                     measurements)) {
+    std::fprintf(stderr, "%s: cannot decode the payload of station %u\n",
+                 input.name.c_str(), from);
+    return;
+  }
+
+  double rate_offset = input.decoder.frameRateOffset();
+  output.rate_offsets[from].add(rate_offset);
+  std::string lines;
+  char line[128];
+  std::snprintf(line, sizeof line, "%s%s.rate_offset %.3f %.0f\n",
+                output.prefix.c_str(), output.name(from).c_str(),
+                100 * rate_offset, rx_time);
+  lines += line;
+  for (const Measurement &measurement : measurements) {
+    std::printf("%s: station %u format %u at %.0f s: %.2f C %.2f %%RH "
+                "battery ",
+                input.name.c_str(), measurement.station_id, measurement.format,
+                measurement.timestamp, measurement.temperature,
+                measurement.humidity);
+    if (measurement.battery_mv)
+      std::printf("%u mV\n", measurement.battery_mv);
+    else
+      std::printf("%u%%\n", measurement.battery);
+
+    std::string path = output.prefix + output.name(measurement.station_id);
+    std::snprintf(line, sizeof line, "%s.temperature %.2f %.0f\n%s.humidity "
+                                     "%.2f %.0f\n",
+                  path.c_str(), measurement.temperature, measurement.timestamp,
+                  path.c_str(), measurement.humidity, measurement.timestamp);
+    lines += line;
+    if (measurement.battery_mv)
+      std::snprintf(line, sizeof line, "%s.battery_mv %u %.0f\n", path.c_str(),
+                    measurement.battery_mv, measurement.timestamp);
+    else
+      std::snprintf(line, sizeof line, "%s.battery %u %.0f\n", path.c_str(),
+                    measurement.battery, measurement.timestamp);
+    lines += line;
+  }
+  std::fflush(stdout);
+  if (output.graphite.enabled())
+    output.graphite.send(lines);
+}
+
+bool openGpio(const std::string &spec, Input &input) {
+  size_t colon = spec.rfind(':');
+  std::string chip = spec.substr(0, colon);
+  if (chip.find('/') == std::string::npos)
+    chip = "/dev/" + chip;
+  int chip_fd = open(chip.c_str(), O_RDONLY | O_CLOEXEC);
+  if (chip_fd < 0) {
+    std::fprintf(stderr, "%s: %s\n", chip.c_str(), std::strerror(errno));
+    return false;
+  }
+
+  gpio_v2_line_request request = {};
+  request.offsets[0] = std::atoi(spec.c_str() + colon + 1);
+  request.num_lines = 1;
+  std::strncpy(request.consumer, "climate_rxd", sizeof request.consumer - 1);
+  request.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+                         GPIO_V2_LINE_FLAG_EDGE_RISING |
+                         GPIO_V2_LINE_FLAG_EDGE_FALLING;
+  request.event_buffer_size = GPIO_EVENT_BUFFER;
+  int result = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request);
+  close(chip_fd);
+  if (result < 0) {
+    std::fprintf(stderr, "%s: %s\n", spec.c_str(), std::strerror(errno));
+    return false;
+  }
+  input.fd = request.fd;
+  input.gpio = true;
+  return true;
+}
+
+bool openInput(const std::string &spec, Input &input) {
+  if (spec.find(':') != std::string::npos &&
+      spec.find("gpiochip") != std::string::npos)
+    return openGpio(spec, input);
+  input.fd = spec == "-" ? STDIN_FILENO : open(spec.c_str(), O_RDONLY);
+  if (input.fd < 0)
+    std::fprintf(stderr, "%s: %s\n", spec.c_str(), std::strerror(errno));
+  return input.fd >= 0;
+}
+
+// Reads the queued edges of a GPIO line, false once it can not be read
+bool readGpio(Input &input, Output &output) {
+  gpio_v2_line_event events[64];
+  ssize_t len = read(input.fd, events, sizeof events);
+  if (len < 0)
+    return errno == EINTR || errno == EAGAIN;
+  // the edge timestamps are CLOCK_MONOTONIC
+  double to_unix =
+      clockSeconds(CLOCK_REALTIME) - clockSeconds(CLOCK_MONOTONIC);
+  for (size_t i = 0; i < len / sizeof *events; i++) {
+    const gpio_v2_line_event &event = events[i];
+    if (input.seqno && event.line_seqno != input.seqno + 1)
+      input.lost += event.line_seqno - input.seqno - 1;
+    input.seqno = event.line_seqno;
+    if (input.decoder.edge(event.timestamp_ns / 1e9,
+                           event.id == GPIO_V2_LINE_EVENT_RISING_EDGE))
+      received(input, input.decoder.frameTime() + to_unix, output);
+  }
+  return len > 0;
+}
+
+// Reads edges from a text input, false at its end
+bool readText(Input &input, Output &output) {
+  char buf[4096];
+  ssize_t len = read(input.fd, buf, sizeof buf);
+  if (len < 0 && (errno == EINTR || errno == EAGAIN))
+    return true;
+  if (len <= 0) {
+    // the recording is over, finish a frame ending low
+    if (input.decoder.idle(input.time + 1))
+      received(input, input.decoder.frameTime(), output);
+    return false;
+  }
+
+  input.line.append(buf, len);
+  size_t start = 0, end;
+  while ((end = input.line.find('\n', start)) != std::string::npos) {
+    double time_us;
+    int level;
+    if (std::sscanf(input.line.c_str() + start, "%lf %d", &time_us, &level) ==
+        2) {
+      input.time = time_us / 1e6;
+      if (input.decoder.edge(input.time, level != 0))
+        received(input, input.decoder.frameTime(), output);
+    }
+    start = end + 1;
+  }
+  input.line.erase(0, start);
+  return true;
+}
+
+void usage() {
+  std::fprintf(stderr, "usage: climate_rxd [-s speed] [-g host[:port]] "
+                       "[-p prefix] [-n id=name]... input...\n"
+                       "input: gpiochipN:line, a file or - for stdin\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned speed = 2000;
+  Output output;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:g:p:n:")) != -1) {
+    switch (opt) {
+    case 's':
+      speed = std::atoi(optarg);
+      break;
+    case 'g':
+      if (!output.graphite.configure(optarg)) {
+        usage();
+        return 2;
+      }
+      break;
+    case 'p':
+      output.prefix = optarg;
+      break;
+    case 'n': {
+      const char *name = std::strchr(optarg, '=');
+      if (!name || !name[1]) {
+        usage();
+        return 2;
+      }
+      output.names[std::atoi(optarg)] = name + 1;
+      break;
+    }
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind >= argc || !speed || speed > 65535) {
+    usage();
+    return 2;
+  }
+
+  double bit_period = askBitPeriod(speed);
+  std::vector<std::unique_ptr<Input>> inputs;
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    std::perror("epoll_create1");
+    return 1;
+  }
+  unsigned open_inputs = 0;
+  for (int i = optind; i < argc; i++) {
+    inputs.emplace_back(new Input(argv[i], bit_period));
+    Input &input = *inputs.back();
+    if (!openInput(argv[i], input))
+      return 1;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = &input;
+    if (!epoll_ctl(epoll_fd, EPOLL_CTL_ADD, input.fd, &event)) {
+      open_inputs++;
+      continue;
+    }
+    if (errno != EPERM) {
+      std::perror("epoll_ctl");
+      return 1;
+    }
+    // regular files can not be polled and are always readable
+    while (readText(input, output))
+      ;
+    close(input.fd);
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = onSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  // Between frames the daemon only wakes for edges. While a decoder collects a
+  // frame it also wakes after IDLE_BITS without edges to complete a frame
+  // whose last bits are low.
+  int idle_ms = std::ceil(IDLE_BITS * bit_period * 1000);
+  while (open_inputs && !stop) {
+    int timeout = -1;
+    for (const auto &input : inputs)
+      if (input->gpio && input->fd >= 0 && input->decoder.active())
+        timeout = idle_ms;
+
+    epoll_event events[16];
+    int count = epoll_wait(epoll_fd, events, 16, timeout);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      std::perror("epoll_wait");
+      return 1;
+    }
+    for (int i = 0; i < count; i++) {
+      Input &input = *static_cast<Input *>(events[i].data.ptr);
+      bool open = input.gpio ? readGpio(input, output)
+                             : readText(input, output);
+      if (!open) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, input.fd, nullptr);
+        close(input.fd);
+        input.fd = -1;
+        open_inputs--;
+      }
+    }
+    if (count)
+      continue;
+
+    double now = clockSeconds(CLOCK_MONOTONIC);
+    double to_unix = clockSeconds(CLOCK_REALTIME) - now;
+    for (const auto &input : inputs)
+      if (input->gpio && input->fd >= 0 && input->decoder.idle(now))
+        received(*input, input->decoder.frameTime() + to_unix, output);
+  }
+
+  for (const auto &input : inputs) {
+    std::fprintf(stderr, "%s: %llu frames, %u dropped for their count or CRC, "
+                         "%u glitches",
+                 input->name.c_str(), (unsigned long long)input->frames,
+                 input->decoder.rxBad(), input->decoder.glitches());
+    if (input->gpio)
+      std::fprintf(stderr, ", %llu edges lost", (unsigned long long)input->lost);
+    std::fprintf(stderr, "\n");
+  }
+  for (const auto &station : output.rate_offsets) {
+    const RateOffsets &offsets = station.second;
+    std::fprintf(stderr, "%s: bit rate %+.2f%% (%+.2f%% to %+.2f%%) in %llu "
+                         "frames\n",
+                 output.name(station.first).c_str(),
+                 100 * offsets.sum / offsets.frames, 100 * offsets.min,
+                 100 * offsets.max, (unsigned long long)offsets.frames);
+  }
+  return 0;
+}
@@ -0,0 +1,706 @@
+// Runs the station firmware in simavr and estimates its energy budget:
+//
+//   energy_profile [-t seconds] [-m current_model] [-i station_id]
+//                  [-T temperature] [-H humidity] [-w waveform]
+//                  firmware.elf
+//
+// The firmware has to be built with PROFILE_PHASES (env:attiny85-profile) so
+// that it marks its loop phases in GPIOR0. simavr has no USI, the tool
+// emulates the USI in two wire mode with an HDC1080 on the bus. It also
+// applies what simavr leaves out: the CPU clock divided by CLKPR and the
+// timers stopped by PRR or in power down.
+//
+// Prints JSON: per phase the CPU cycles, the time spent active, in idle (or
+// ADC noise reduction) sleep and in power down, how long every peripheral was
+// on and the charge drawn, then the average current, charge and energy per
+// sample and the battery life. The current model is a file of "name value"
+// lines overriding the defaults of CurrentModel. stack_bytes is the deepest
+// stack seen, from the stack pointer after every instruction and interrupt.
+//
+// -w writes the transmitter pin (PB1) as "time_us level" lines, one per level
+// change, the input of link_sim.
+//
+// Experimental, built with -D ENERGY_PROFILE=ON only. The emulated USI and
+// HDC1080, the clock gating and the phase markers have not been checked
+// against a real simavr yet, test/energy_profile_smoke.py does that once the
+// profile firmware is built. Until it passes, treat the figures with care.
+#include "profile_phase.hpp"
+
+#include <simavr/avr_eeprom.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// ATtiny85 registers in the data address space
+constexpr uint16_t USICR = 0x2d;
+constexpr uint16_t USISR = 0x2e;
+constexpr uint16_t USIDR = 0x2f;
+constexpr uint16_t DDRB = 0x37;
+constexpr uint16_t PORTB = 0x38;
+constexpr uint16_t PRR = 0x40;
+constexpr uint16_t CLKPR = 0x46;
+constexpr uint16_t TCCR1 = 0x50;
+constexpr uint16_t TCCR0B = 0x53;
+constexpr uint16_t MCUCR = 0x55;
+constexpr uint16_t SPL = 0x5d;
+constexpr uint16_t SPH = 0x5e;
+constexpr uint16_t RAMEND = 0x25f;
+constexpr uint16_t ADCSRA = 0x26;
+
+constexpr uint8_t PRADC = 1 << 0;
+constexpr uint8_t PRUSI = 1 << 1;
+constexpr uint8_t PRTIM0 = 1 << 2;
+constexpr uint8_t PRTIM1 = 1 << 3;
+constexpr uint8_t ADEN = 1 << 7;
+constexpr uint8_t USIOIF = 1 << 6;
+constexpr uint8_t USIWM1 = 1 << 5;
+constexpr uint8_t USITC = 1 << 0;
+
+// MCUCR SM1:0
+constexpr uint8_t SLEEP_MODE_MASK = 0x18;
+constexpr uint8_t SLEEP_MODE_PWR_DOWN = 0x10;
+
+// pins of the station: I2C on the USI pins, RH_TX_PIN of main.cpp
+constexpr uint8_t SDA_PIN = 1 << 0;
+constexpr uint8_t SCL_PIN = 1 << 2;
+constexpr uint8_t RADIO_TX_PIN = 1 << 1;
+
+const char *const PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "other", "battery", "measure", "encode", "transmit", "sleep"};
+
+// Typical figures of the ATtiny85 and HDC1080 datasheets at 3 V, replace them
+// with measurements of the real board
+struct CurrentModel {
+  double vcc_mv = 3600;           // supply, also the Vcc the ADC sees
+  double capacity_mah = 2000;     // usable battery capacity
+  double active_ua_per_mhz = 330; // CPU running
+  double idle_ua_per_mhz = 80;    // idle and ADC noise reduction sleep
+  double power_down_ua = 4;       // watchdog running
+  double timer0_ua_per_mhz = 3;   // peripheral clocks not gated by PRR
+  double timer1_ua_per_mhz = 15;
+  double usi_ua_per_mhz = 3;
+  double adc_clock_ua_per_mhz = 8;
+  double adc_ua = 230;            // ADC enabled (ADEN)
+  double radio_tx_ua = 9000;      // transmitter keyed, data pin high
+  double sensor_convert_ua = 190; // HDC1080 converting
+  double sensor_sleep_ua = 0.1;
+  double board_ua = 0; // anything else, e.g. leakage of the battery divider
+};
+
+bool readModel(const char *path, CurrentModel &model) {
+  const struct {
+    const char *name;
+    double CurrentModel::*value;
+  } fields[] = {{"vcc_mv", &CurrentModel::vcc_mv},
+                {"capacity_mah", &CurrentModel::capacity_mah},
+                {"active_ua_per_mhz", &CurrentModel::active_ua_per_mhz},
+                {"idle_ua_per_mhz", &CurrentModel::idle_ua_per_mhz},
+                {"power_down_ua", &CurrentModel::power_down_ua},
+                {"timer0_ua_per_mhz", &CurrentModel::timer0_ua_per_mhz},
+                {"timer1_ua_per_mhz", &CurrentModel::timer1_ua_per_mhz},
+                {"usi_ua_per_mhz", &CurrentModel::usi_ua_per_mhz},
+                {"adc_clock_ua_per_mhz", &CurrentModel::adc_clock_ua_per_mhz},
+                {"adc_ua", &CurrentModel::adc_ua},
+                {"radio_tx_ua", &CurrentModel::radio_tx_ua},
+                {"sensor_convert_ua", &CurrentModel::sensor_convert_ua},
+                {"sensor_sleep_ua", &CurrentModel::sensor_sleep_ua},
+                {"board_ua", &CurrentModel::board_ua}};
+
+  std::ifstream file(path);
+  if (!file) {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream words(line.substr(0, line.find('#')));
+    std::string name;
+    double value;
+    if (!(words >> name))
+      continue;
+    bool known = false;
+    for (const auto &field : fields) {
+      if (name == field.name && (words >> value)) {
+        model.*field.value = value;
+        known = true;
+      }
+    }
+    if (!known) {
+      std::fprintf(stderr, "%s: cannot parse: %s\n", path, line.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// HDC1080 register set behind the I2C state machine, byte level
+class Hdc1080 {
+public:
+  Hdc1080(double temperature, double humidity)
+      : _temperature(temperature), _humidity(humidity) {}
+
+  // address byte with the R/W bit, returns the ACK. A read NACKs while a
+  // conversion is running.
+  bool address(uint8_t byte, double now_us) {
+    if (byte >> 1 != 0x40)
+      return false;
+    _written = 0;
+    _read = 0;
+    if (byte & 1) {
+      if (converting(now_us) && _pointer <= 0x01)
+        return false;
+      prepareRead();
+    }
+    return true;
+  }
+
+  // the first byte sets the register pointer, pointing to a measurement
+  // register triggers a conversion
+  bool write(uint8_t byte, double now_us) {
+    if (_written++ == 0) {
+      _pointer = byte;
+      if (_pointer <= 0x01) {
+        _conversion_end_us = now_us + conversionUs();
+        _conversions++;
+      }
+    } else if (_pointer == 0x02 && _written <= 3) {
+      _config = _written == 2 ? (_config & 0x00ff) | byte << 8
+                              : (_config & 0xff00) | byte;
+    }
+    return true;
+  }
+
+  uint8_t read() { return _read < sizeof(_out) ? _out[_read++] : 0xff; }
+
+  bool converting(double now_us) const { return now_us < _conversion_end_us; }
+  unsigned conversions() const { return _conversions; }
+
+private:
+  bool sequence() const { return _config & 0x1000; }
+
+  double conversionUs() const {
+    double temperature = _config & 0x0400 ? 3650 : 6350;
+    double humidity = _config & 0x0200 ? 2500 : _config & 0x0100 ? 3850 : 6500;
+    if (_pointer == 0x01)
+      return humidity;
+    return sequence() ? temperature + humidity : temperature;
+  }
+
+  // 16 bit register value with the bits below the resolution cleared
+  static uint16_t code(double fraction, unsigned bits) {
+    double value = std::round(fraction * 65536);
+    value = value < 0 ? 0 : value > 65535 ? 65535 : value;
+    return (uint16_t)value & ~((1u << (16 - bits)) - 1);
+  }
+
+  void put(unsigned index, uint16_t value) {
+    _out[2 * index] = value >> 8;
+    _out[2 * index + 1] = value & 0xff;
+  }
+
+  void prepareRead() {
+    uint16_t temperature = code((_temperature + 40) / 165,
+                                _config & 0x0400 ? 11 : 14);
+    uint16_t humidity =
+        code(_humidity / 100,
+             _config & 0x0200 ? 8 : _config & 0x0100 ? 11 : 14);
+    switch (_pointer) {
+    case 0x00:
+      put(0, temperature);
+      put(1, humidity);
+      break;
+    case 0x01:
+      put(0, humidity);
+      break;
+    case 0x02:
+      put(0, _config);
+      break;
+    case 0xfe:
+      put(0, 0x5449); // manufacturer id
+      break;
+    case 0xff:
+      put(0, 0x1050); // device id
+      break;
+    default:
+      put(0, 0);
+    }
+  }
+
+  double _temperature;
+  double _humidity;
+  uint8_t _pointer = 0;
+  uint16_t _config = 0x1000;
+  unsigned _written = 0;
+  uint8_t _out[4] = {};
+  unsigned _read = 0;
+  double _conversion_end_us = 0;
+  unsigned _conversions = 0;
+};
+
+// The USI in two wire mode the way usi_i2c_master drives it: every USITC
+// strobe toggles SCL and counts, the shift register samples SDA on the rising
+// edge and its MSB drives SDA from the falling edge on. Start and stop
+// conditions come from the port and direction bits. The lines are open drain
+// with pull-ups, the slave only pulls SDA low inside the USI shift.
+class UsiBus {
+public:
+  UsiBus(avr_t *avr, Hdc1080 &sensor, const double &now_us)
+      : _avr(avr), _sensor(sensor), _now_us(now_us) {
+    avr_register_io_write(avr, USICR, writeUsicr, this);
+    avr_register_io_write(avr, USISR, writeUsisr, this);
+    avr_register_io_write(avr, USIDR, writeUsidr, this);
+    avr_register_io_write(avr, PORTB, writePort, this);
+    avr_register_io_write(avr, DDRB, writePort, this);
+
+    // released inputs read high
+    avr_ioport_external_t pull_ups;
+    pull_ups.name = 'B';
+    pull_ups.mask = SDA_PIN | SCL_PIN;
+    pull_ups.value = SDA_PIN | SCL_PIN;
+    avr_ioctl(avr, AVR_IOCTL_IOPORT_SET_EXTERNAL('B'), &pull_ups);
+  }
+
+private:
+  enum State { IDLE, ADDRESS, WRITE, READ };
+
+  bool scl() const {
+    return !((_avr->data[DDRB] & SCL_PIN) && !(_avr->data[PORTB] & SCL_PIN));
+  }
+
+  bool masterSda() const {
+    return !((_avr->data[DDRB] & SDA_PIN) &&
+             (!(_avr->data[PORTB] & SDA_PIN) || !_latch));
+  }
+
+  static void writeUsicr(avr_t *avr, avr_io_addr_t addr, uint8_t v,
+                         void *param) {
+    avr->data[addr] = v & ~USITC;
+    if ((v & USITC) && (v & USIWM1))
+      static_cast<UsiBus *>(param)->strobe();
+  }
+
+  // the flags clear by writing ones, the counter is written as is
+  static void writeUsisr(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *) {
+    avr->data[addr] = (avr->data[addr] & 0xf0 & ~v) | (v & 0x0f);
+  }
+
+  static void writeUsidr(avr_t *avr, avr_io_addr_t addr, uint8_t v,
+                         void *param) {
+    UsiBus *bus = static_cast<UsiBus *>(param);
+    avr->data[addr] = v;
+    if (!bus->scl())
+      bus->_latch = v & 0x80;
+    bus->update();
+  }
+
+  // called after the port module stored the value
+  static void writePort(avr_t *, avr_io_addr_t, uint8_t, void *param) {
+    static_cast<UsiBus *>(param)->update();
+  }
+
+  void update() {
+    bool scl_now = scl(), sda_now = masterSda();
+    if (_scl && scl_now && _sda != sda_now) {
+      if (!sda_now)
+        start();
+      else
+        stop();
+    }
+    _scl = scl_now;
+    _sda = sda_now;
+  }
+
+  void strobe() {
+    _avr->data[PORTB] ^= SCL_PIN;
+    uint8_t usisr = _avr->data[USISR];
+    uint8_t counter = (usisr + 1) & 0x0f;
+    _avr->data[USISR] = (usisr & 0xf0) | counter | (counter ? 0 : USIOIF);
+
+    bool scl_now = scl();
+    if (scl_now && !_scl) {
+      bool sda = masterSda() && !_slave_low;
+      _avr->data[USIDR] = _avr->data[USIDR] << 1 | sda;
+      rising(sda);
+    } else if (!scl_now && _scl) {
+      _latch = _avr->data[USIDR] & 0x80;
+      falling();
+    }
+    _scl = scl_now;
+    _sda = masterSda();
+  }
+
+  void start() {
+    _state = ADDRESS;
+    _bit = 0;
+    _slave_low = false;
+  }
+
+  void stop() {
+    _state = IDLE;
+    _slave_low = false;
+  }
+
+  void rising(bool sda) {
+    if (_state == IDLE)
+      return;
+    if (_bit < 8) {
+      if (_state != READ)
+        _shift = _shift << 1 | sda;
+    } else if (_state == READ) {
+      _master_ack = !sda;
+    }
+    _bit++;
+  }
+
+  void falling() {
+    switch (_state) {
+    case IDLE:
+      return;
+    case ADDRESS:
+    case WRITE:
+      if (_bit == 8) {
+        bool ack = _state == ADDRESS ? _sensor.address(_shift, _now_us)
+                                     : _sensor.write(_shift, _now_us);
+        _slave_low = ack;
+        if (!ack)
+          _state = IDLE;
+      } else if (_bit == 9) {
+        _bit = 0;
+        _slave_low = false;
+        if (_state == ADDRESS && (_shift & 1)) {
+          _state = READ;
+          nextByte();
+        } else {
+          _state = WRITE;
+        }
+      }
+      break;
+    case READ:
+      if (_bit == 8) {
+        _slave_low = false; // the master acknowledges
+      } else if (_bit == 9) {
+        _bit = 0;
+        if (_master_ack) {
+          nextByte();
+        } else {
+          _state = IDLE;
+        }
+      } else {
+        _slave_low = !(_byte & (0x80 >> _bit));
+      }
+      break;
+    }
+  }
+
+  void nextByte() {
+    _byte = _sensor.read();
+    _slave_low = !(_byte & 0x80);
+  }
+
+  avr_t *_avr;
+  Hdc1080 &_sensor;
+  const double &_now_us;
+  bool _latch = true;
+  bool _scl = true;
+  bool _sda = true;
+  State _state = IDLE;
+  uint8_t _bit = 0;
+  uint8_t _shift = 0;
+  uint8_t _byte = 0;
+  bool _slave_low = false;
+  bool _master_ack = false;
+};
+
+// writes a register the way an instruction does, through the simulated
+// peripheral that owns it
+void writeIo(avr_t *avr, uint16_t addr, uint8_t value) {
+  avr_io_addr_t io = AVR_DATA_TO_IO(addr);
+  if (avr->io[io].w.c)
+    avr->io[io].w.c(avr, addr, value, avr->io[io].w.param);
+  else
+    avr->data[addr] = value;
+}
+
+// Stops a timer the way PRR or power down does, by clearing its clock
+// select bits, and restores them when it gets its clock back
+class TimerGate {
+public:
+  TimerGate(uint16_t reg, uint8_t cs_mask) : _reg(reg), _cs_mask(cs_mask) {}
+
+  void set(avr_t *avr, bool gated) {
+    if (gated == _gated)
+      return;
+    uint8_t value = avr->data[_reg];
+    if (gated) {
+      _cs = value & _cs_mask;
+      writeIo(avr, _reg, value & ~_cs_mask);
+    } else {
+      writeIo(avr, _reg, (value & ~_cs_mask) | _cs);
+    }
+    _gated = gated;
+  }
+
+private:
+  uint16_t _reg;
+  uint8_t _cs_mask;
+  uint8_t _cs = 0;
+  bool _gated = false;
+};
+
+struct PhaseStats {
+  unsigned entries = 0;
+  uint64_t cycles = 0; // executed, not slept
+  double active_s = 0;
+  double idle_s = 0; // idle and ADC noise reduction sleep
+  double power_down_s = 0;
+  double timer0_s = 0; // clocked
+  double timer1_s = 0;
+  double usi_s = 0;
+  double adc_s = 0; // enabled
+  double radio_s = 0; // keyed
+  double sensor_s = 0; // converting
+  double charge_uc = 0;
+};
+
+void noSleep(avr_t *, avr_cycle_count_t) {}
+
+void printPhase(const char *name, const PhaseStats &stats, bool last) {
+  std::printf("    \"%s\": {\"entries\": %u, \"cycles\": %llu, "
+              "\"active_s\": %.6f, \"idle_s\": %.6f, \"power_down_s\": %.3f, "
+              "\"timer0_s\": %.6f, \"timer1_s\": %.6f, \"usi_s\": %.6f, "
+              "\"adc_s\": %.6f, \"radio_s\": %.6f, \"sensor_s\": %.6f, "
+              "\"charge_uc\": %.3f}%s\n",
+              name, stats.entries, (unsigned long long)stats.cycles,
+              stats.active_s, stats.idle_s, stats.power_down_s,
+              stats.timer0_s, stats.timer1_s, stats.usi_s, stats.adc_s,
+              stats.radio_s, stats.sensor_s, stats.charge_uc,
+              last ? "" : ",");
+}
+
+void usage() {
+  std::fprintf(stderr, "usage: energy_profile [-t seconds] [-m current_model] "
+                       "[-i station_id] [-T temperature] [-H humidity] "
+                       "[-w waveform] firmware.elf\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  double duration = 3600;
+  CurrentModel model;
+  unsigned station_id = 1;
+  double temperature = 21;
+  double humidity = 45;
+  const char *waveform_path = nullptr;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "t:m:i:T:H:w:")) != -1) {
+    switch (opt) {
+    case 't':
+      duration = std::atof(optarg);
+      break;
+    case 'm':
+      if (!readModel(optarg, model))
+        return 2;
+      break;
+    case 'i':
+      station_id = std::atoi(optarg);
+      break;
+    case 'T':
+      temperature = std::atof(optarg);
+      break;
+    case 'H':
+      humidity = std::atof(optarg);
+      break;
+    case 'w':
+      waveform_path = optarg;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind + 1 != argc || duration <= 0) {
+    usage();
+    return 2;
+  }
+
+  FILE *waveform = nullptr;
+  if (waveform_path && !(waveform = std::fopen(waveform_path, "w"))) {
+    std::fprintf(stderr, "cannot write %s\n", waveform_path);
+    return 1;
+  }
+
+  elf_firmware_t firmware = {};
+  if (elf_read_firmware(argv[optind], &firmware)) {
+    std::fprintf(stderr, "cannot read %s\n", argv[optind]);
+    return 1;
+  }
+  avr_t *avr = avr_make_mcu_by_name("attiny85");
+  if (!avr || avr_init(avr)) {
+    std::fprintf(stderr, "simavr has no attiny85\n");
+    return 1;
+  }
+  avr_load_firmware(avr, &firmware);
+  if (!avr->frequency)
+    avr->frequency = 8000000;
+  avr->vcc = avr->avcc = model.vcc_mv;
+  // run as fast as possible instead of in real time
+  avr->sleep = noSleep;
+
+  // the station id lives in EEPROM byte 0
+  uint8_t id = station_id;
+  avr_eeprom_desc_t eeprom = {&id, 0, 1};
+  avr_ioctl(avr, AVR_IOCTL_EEPROM_SET, &eeprom);
+
+  double now_us = 0;
+  Hdc1080 sensor(temperature, humidity);
+  UsiBus bus(avr, sensor, now_us);
+  TimerGate timer0(TCCR0B, 0x07), timer1(TCCR1, 0x0f);
+
+  PhaseStats phases[PROFILE_PHASE_COUNT];
+  uint8_t phase = PROFILE_PHASE_COUNT;
+  bool marked = false;
+  const double cycle_us = 1e6 / avr->frequency;
+  uint16_t min_sp = RAMEND;
+
+  while (now_us < duration * 1e6) {
+    // the state at the start of the step holds for all of its cycles
+    uint8_t marker = avr->data[PROFILE_PHASE_REGISTER];
+    if (marker >= PROFILE_PHASE_COUNT)
+      marker = PROFILE_PHASE_OTHER;
+    marked |= marker != PROFILE_PHASE_OTHER;
+    if (marker != phase)
+      phases[marker].entries++;
+    phase = marker;
+    PhaseStats &stats = phases[phase];
+
+    bool sleeping = avr->state == cpu_Sleeping;
+    bool power_down =
+        sleeping && (avr->data[MCUCR] & SLEEP_MODE_MASK) == SLEEP_MODE_PWR_DOWN;
+    uint8_t prr = avr->data[PRR];
+    timer0.set(avr, power_down || (prr & PRTIM0));
+    timer1.set(avr, power_down || (prr & PRTIM1));
+    uint8_t clock_shift = avr->data[CLKPR] & 0x0f;
+    bool adc = avr->data[ADCSRA] & ADEN;
+    bool radio = avr->data[DDRB] & avr->data[PORTB] & RADIO_TX_PIN;
+    bool converting = sensor.converting(now_us);
+
+    avr_cycle_count_t start = avr->cycle;
+    int state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed) {
+      std::fprintf(stderr, "firmware %s after %.3f s\n",
+                   state == cpu_Done ? "stopped" : "crashed", now_us / 1e6);
+      return 1;
+    }
+    uint16_t sp = avr->data[SPL] | avr->data[SPH] << 8;
+    if (sp < min_sp)
+      min_sp = sp;
+    bool radio_after = avr->data[DDRB] & avr->data[PORTB] & RADIO_TX_PIN;
+
+    // The watchdog keeps its own clock in power down, everything else runs
+    // from the divided system clock
+    avr_cycle_count_t cycles = avr->cycle - start;
+    double us = cycles * cycle_us * (power_down ? 1 : 1 << clock_shift);
+    double seconds = us / 1e6;
+    now_us += us;
+    if (waveform && radio_after != radio)
+      std::fprintf(waveform, "%.3f %d\n", now_us, radio_after);
+
+    double mhz = avr->frequency / 1e6 / (1 << clock_shift);
+    double current = model.board_ua;
+    if (power_down) {
+      current += model.power_down_ua;
+      stats.power_down_s += seconds;
+    } else {
+      if (sleeping) {
+        current += model.idle_ua_per_mhz * mhz;
+        stats.idle_s += seconds;
+      } else {
+        current += model.active_ua_per_mhz * mhz;
+        stats.active_s += seconds;
+        stats.cycles += cycles;
+      }
+      if (!(prr & PRTIM0)) {
+        current += model.timer0_ua_per_mhz * mhz;
+        stats.timer0_s += seconds;
+      }
+      if (!(prr & PRTIM1)) {
+        current += model.timer1_ua_per_mhz * mhz;
+        stats.timer1_s += seconds;
+      }
+      if (!(prr & PRUSI)) {
+        current += model.usi_ua_per_mhz * mhz;
+        stats.usi_s += seconds;
+      }
+      if (!(prr & PRADC))
+        current += model.adc_clock_ua_per_mhz * mhz;
+    }
+    if (adc) {
+      current += model.adc_ua;
+      stats.adc_s += seconds;
+    }
+    if (radio) {
+      current += model.radio_tx_ua;
+      stats.radio_s += seconds;
+    }
+    if (converting) {
+      current += model.sensor_convert_ua;
+      stats.sensor_s += seconds;
+    } else {
+      current += model.sensor_sleep_ua;
+    }
+    stats.charge_uc += current * seconds;
+  }
+
+  if (waveform)
+    std::fclose(waveform);
+  if (!marked)
+    std::fprintf(stderr, "no phase markers, was the firmware built with "
+                         "PROFILE_PHASES?\n");
+
+  PhaseStats total;
+  for (const PhaseStats &stats : phases) {
+    total.cycles += stats.cycles;
+    total.active_s += stats.active_s;
+    total.idle_s += stats.idle_s;
+    total.charge_uc += stats.charge_uc;
+  }
+  double seconds = now_us / 1e6;
+  double average_ua = total.charge_uc / seconds;
+  unsigned samples = sensor.conversions();
+  unsigned frames = phases[PROFILE_PHASE_ENCODE].entries;
+
+  std::printf("{\n  \"firmware\": \"%s\",\n", argv[optind]);
+  std::printf("  \"simulated_s\": %.3f,\n  \"cpu_hz\": %u,\n  \"vcc_mv\": "
+              "%.0f,\n",
+              seconds, avr->frequency, model.vcc_mv);
+  std::printf("  \"samples\": %u,\n  \"frames\": %u,\n", samples, frames);
+  std::printf("  \"phases\": {\n");
+  for (unsigned i = 0; i < PROFILE_PHASE_COUNT; i++)
+    printPhase(PHASE_NAMES[i], phases[i], i + 1 == PROFILE_PHASE_COUNT);
+  std::printf("  },\n");
+  std::printf("  \"stack_bytes\": %u,\n", RAMEND - min_sp);
+  std::printf("  \"cycles\": %llu,\n  \"awake_s\": %.6f,\n",
+              (unsigned long long)total.cycles,
+              total.active_s + total.idle_s);
+  std::printf("  \"average_ua\": %.3f,\n", average_ua);
+  std::printf("  \"charge_per_sample_uc\": %.3f,\n",
+              samples ? total.charge_uc / samples : 0.0);
+  std::printf("  \"energy_per_sample_uj\": %.3f,\n",
+              samples ? total.charge_uc * model.vcc_mv / 1000 / samples : 0.0);
+  std::printf("  \"battery_life_days\": %.1f\n}\n",
+              model.capacity_mah * 1000 / average_ua / 24);
+  return 0;
+}
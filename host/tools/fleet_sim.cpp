@@ -0,0 +1,364 @@
+// Discrete event simulation of a fleet of stations on one ASK channel:
+//
+//   fleet_sim [-n stations] [-p payload_len] [-b samples_per_frame]
+//             [-s speed] [-w wakeups] [-c clock_error_%] [-J jitter_ms]
+//             [-f send_fraction] [-P power_spread_db] [-C capture_db]
+//             [-h hours] [-j threads] [-r seed] [-T] [station id...]
+//
+// Stations 1..n (or the ids given) send a frame every -b cycles of -w
+// watchdog wakeups plus their TDMA stretch (-T turns the stretch off), or
+// skip it with probability 1 - f (send on change). Each frame carries -b
+// samples, its airtime follows the RH_ASK framing of a -p byte payload (the
+// format 2 or batch length by default). Every station gets a fixed clock error
+// within +-c percent (what is left after the watchdog calibration, 0.1% by
+// default), a gaussian wakeup jitter of -J ms and a received power within
+// -P dB.
+//
+// Frames that overlap are resolved like the RH_ASK receiver does:
+// - an interferer that ends within the training part of the preamble (all but
+//   the last 2 symbols) does no harm, the receiver still finds the start
+//   symbol
+// - once the receiver has the start symbol of a frame it collects that frame
+//   until its count is complete, a frame whose start symbol arrives meanwhile
+//   is lost however strong it is
+// - otherwise a frame survives an overlap if it is more than -C dB stronger
+//   (capture effect)
+//
+// Every thread simulates its own fleet (random phases, clock errors and
+// powers) for its share of -h hours. Prints per station the delivery ratio and
+// the loss bursts (consecutive lost frames), then the delivered samples per
+// hour, the channel utilisation and the simulation speed at the send fraction.
+#include "ask_codec.hpp"
+#include "climate_protocol.hpp"
+#include "tdma_schedule.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <queue>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr double WATCHDOG_WAKEUP_S = 8; // WATCHDOG_TIME
+
+// the receiver needs the last 2 preamble symbols (0x38, 0x2c) in its shift
+// register, the bits before only train its PLL
+constexpr unsigned TRAINING_BITS = 6 * (ASK_PREAMBLE_LEN - 2);
+constexpr unsigned SYNC_BITS = 6 * ASK_PREAMBLE_LEN;
+
+struct Config {
+  unsigned payload_len;
+  unsigned samples_per_frame = 1;
+  unsigned speed = 2000;
+  unsigned wakeups = 7;
+  double clock_error = 0.001;
+  double jitter = 0.01; // s
+  double send_fraction = 1;
+  double power_spread = 10; // dB
+  double capture = 6;       // dB
+  bool tdma = true;
+};
+
+struct StationStats {
+  uint64_t sent = 0;
+  uint64_t lost = 0;
+  uint64_t bursts = 0;
+  uint64_t longest_burst = 0;
+};
+
+struct Result {
+  std::vector<StationStats> stations;
+  double airtime = 0; // s
+  double seconds = 0;
+};
+
+struct Frame {
+  double start;
+  uint32_t station;
+  bool lost;
+};
+
+struct Event {
+  double time;
+  uint32_t station;
+  bool operator>(const Event &other) const { return time > other.time; }
+};
+
+// nominal time between two frames of a station
+double framePeriod(const Config &config, unsigned id, uint8_t slot_ticks) {
+  double cycle = config.wakeups * WATCHDOG_WAKEUP_S;
+  if (config.tdma)
+    cycle += tdmaStretchTicks(id, slot_ticks) * TDMA_TICK_MS / 1000.0;
+  return config.samples_per_frame * cycle;
+}
+
+class Fleet {
+public:
+  Fleet(const Config &config, const std::vector<unsigned> &ids, uint64_t seed)
+      : _config(config), _rng(seed),
+        _skipped(std::min(config.send_fraction, 1.0)),
+        _jitter(0, std::max(config.jitter, 1e-9)), _stats(ids.size()),
+        _run(ids.size()) {
+    double bit = 1.0 / config.speed;
+    _airtime = 6 * tdmaFrameSymbols(config.payload_len) * bit;
+    _training = TRAINING_BITS * bit;
+    _sync = SYNC_BITS * bit;
+
+    uint8_t slot_ticks =
+        tdmaSlotTicks(tdmaAirtimeMs(config.payload_len, config.speed));
+    std::uniform_real_distribution<double> unit(0, 1);
+    for (unsigned id : ids) {
+      double error = config.clock_error * (2 * unit(_rng) - 1);
+      _period.push_back(framePeriod(config, id, slot_ticks) * (1 + error));
+      _power.push_back(config.power_spread * unit(_rng));
+    }
+  }
+
+  Result run(double seconds) {
+    std::uniform_real_distribution<double> unit(0, 1);
+    for (uint32_t i = 0; i < _period.size(); i++)
+      _events.push({nextFrame(i, unit(_rng) * _period[i] - _period[i]), i});
+
+    Result result;
+    while (!_events.empty() && _events.top().time < seconds) {
+      Event event = _events.top();
+      _events.pop();
+
+      // frames that ended can not collide any more, all have the same length
+      while (!_active.empty() &&
+             _active.front().start + _airtime <= event.time)
+        finish();
+
+      Frame frame = {event.time, event.station, false};
+      for (Frame &other : _active) {
+        frame.lost |= corrupts(frame, other);
+        other.lost |= corrupts(other, frame);
+      }
+      _active.push_back(frame);
+      result.airtime += _airtime;
+
+      _events.push({nextFrame(event.station, event.time), event.station});
+    }
+    while (!_active.empty())
+      finish();
+
+    result.stations = _stats;
+    result.seconds = seconds;
+    return result;
+  }
+
+private:
+  // start of the frame after the one at time, skipping cycles without change
+  double nextFrame(uint32_t station, double time) {
+    unsigned cycles = 1;
+    if (_config.send_fraction < 1)
+      cycles += _skipped(_rng);
+    time += cycles * _period[station];
+    if (_config.jitter > 0)
+      time += _jitter(_rng);
+    return time;
+  }
+
+  // true if other, which overlaps frame, keeps the receiver from decoding it
+  bool corrupts(const Frame &frame, const Frame &other) const {
+    if (other.start < frame.start) {
+      if (other.start + _airtime <= frame.start + _training)
+        return false;
+      // the receiver is busy with other when the start symbol of frame comes
+      if (other.start + _sync <= frame.start)
+        return true;
+    }
+    return _power[frame.station] <= _power[other.station] + _config.capture;
+  }
+
+  void finish() {
+    const Frame &frame = _active.front();
+    StationStats &stats = _stats[frame.station];
+    uint64_t &run = _run[frame.station];
+    stats.sent++;
+    if (frame.lost) {
+      stats.lost++;
+      if (!run++)
+        stats.bursts++;
+      stats.longest_burst = std::max(stats.longest_burst, run);
+    } else {
+      run = 0;
+    }
+    _active.pop_front();
+  }
+
+  const Config &_config;
+  std::mt19937_64 _rng;
+  std::geometric_distribution<unsigned> _skipped; // cycles without a frame
+  std::normal_distribution<double> _jitter;
+  double _airtime;
+  double _training;
+  double _sync;
+  std::vector<double> _period;
+  std::vector<double> _power;
+  std::vector<StationStats> _stats;
+  std::vector<uint64_t> _run; // current run of lost frames per station
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> _events;
+  std::deque<Frame> _active; // frames on air, oldest first
+};
+
+void usage() {
+  std::fprintf(stderr, "usage: fleet_sim [-n stations] [-p payload_len] "
+                       "[-b samples_per_frame] [-s speed] [-w wakeups] "
+                       "[-c clock_error_%%] [-J jitter_ms] [-f send_fraction] "
+                       "[-P power_spread_db] [-C capture_db] [-h hours] "
+                       "[-j threads] [-r seed] [-T] [station id...]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Config config;
+  unsigned stations = 10;
+  int payload_len = -1;
+  double hours = 10000;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  unsigned seed = 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:p:b:s:w:c:J:f:P:C:h:j:r:T")) != -1) {
+    switch (opt) {
+    case 'n':
+      stations = std::atoi(optarg);
+      break;
+    case 'p':
+      payload_len = std::atoi(optarg);
+      break;
+    case 'b':
+      config.samples_per_frame = std::atoi(optarg);
+      break;
+    case 's':
+      config.speed = std::atoi(optarg);
+      break;
+    case 'w':
+      config.wakeups = std::atoi(optarg);
+      break;
+    case 'c':
+      config.clock_error = std::atof(optarg) / 100;
+      break;
+    case 'J':
+      config.jitter = std::atof(optarg) / 1000;
+      break;
+    case 'f':
+      config.send_fraction = std::atof(optarg);
+      break;
+    case 'P':
+      config.power_spread = std::atof(optarg);
+      break;
+    case 'C':
+      config.capture = std::atof(optarg);
+      break;
+    case 'h':
+      hours = std::atof(optarg);
+      break;
+    case 'j':
+      threads = std::atoi(optarg);
+      break;
+    case 'r':
+      seed = std::atoi(optarg);
+      break;
+    case 'T':
+      config.tdma = false;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (payload_len < 0)
+    payload_len = config.samples_per_frame == 1
+                      ? CLIMATE_V2_PAYLOAD_LEN
+                      : CLIMATE_BATCH_MAX_LEN(config.samples_per_frame);
+  config.payload_len = payload_len;
+  if (!config.speed || !config.wakeups || !config.samples_per_frame ||
+      config.samples_per_frame > CLIMATE_BATCH_MAX_SAMPLES ||
+      config.payload_len > ASK_MAX_FRAME_LEN - ASK_FRAME_OVERHEAD ||
+      config.send_fraction <= 0 || hours <= 0 || !threads) {
+    usage();
+    return 2;
+  }
+
+  std::vector<unsigned> ids;
+  for (int i = optind; i < argc; i++)
+    ids.push_back(std::atoi(argv[i]));
+  if (ids.empty())
+    for (unsigned id = 1; id <= stations; id++)
+      ids.push_back(id);
+  for (unsigned id : ids)
+    if (!id || id > 255) {
+      usage();
+      return 2;
+    }
+
+  auto started = std::chrono::steady_clock::now();
+  std::vector<Result> results(threads);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++)
+    workers.emplace_back([&, i] {
+      Fleet fleet(config, ids, seed * 0x9e3779b97f4a7c15ULL + i);
+      results[i] = fleet.run(hours * 3600 / threads);
+    });
+  for (std::thread &worker : workers)
+    worker.join();
+  double wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - started)
+                    .count();
+
+  Result total = results[0];
+  for (unsigned i = 1; i < threads; i++) {
+    total.airtime += results[i].airtime;
+    total.seconds += results[i].seconds;
+    for (size_t s = 0; s < ids.size(); s++) {
+      StationStats &stats = total.stations[s];
+      const StationStats &other = results[i].stations[s];
+      stats.sent += other.sent;
+      stats.lost += other.lost;
+      stats.bursts += other.bursts;
+      stats.longest_burst = std::max(stats.longest_burst, other.longest_burst);
+    }
+  }
+
+  double total_hours = total.seconds / 3600;
+  uint8_t slot_ticks =
+      tdmaSlotTicks(tdmaAirtimeMs(config.payload_len, config.speed));
+  std::printf("frame %u bytes payload, %.1f ms airtime, %u samples each\n",
+              config.payload_len,
+              6000.0 * tdmaFrameSymbols(config.payload_len) / config.speed,
+              config.samples_per_frame);
+  uint64_t sent = 0, lost = 0;
+  for (size_t s = 0; s < ids.size(); s++) {
+    const StationStats &stats = total.stations[s];
+    sent += stats.sent;
+    lost += stats.lost;
+    std::printf("station %3u period %8.3f s delivered %7.3f%%, %.2f loss "
+                "bursts per day, longest %llu frames\n",
+                ids[s], framePeriod(config, ids[s], slot_ticks),
+                stats.sent ? 100.0 * (stats.sent - stats.lost) / stats.sent
+                           : 100,
+                stats.bursts * 24 / total_hours,
+                (unsigned long long)stats.longest_burst);
+  }
+  std::printf("delivered %.1f of %.1f samples per hour (%.3f%%), channel "
+              "utilisation %.3f%%\n",
+              (sent - lost) * config.samples_per_frame / total_hours,
+              sent * config.samples_per_frame / total_hours,
+              sent ? 100.0 * (sent - lost) / sent : 100,
+              100 * total.airtime / total.seconds);
+  // the cost follows the frames, so the speed only holds for this fraction
+  std::printf("simulated %.0f hours in %.2f s on %u threads (%.3g hours per "
+              "minute at send fraction %g)\n",
+              total_hours, wall, threads, total_hours / wall * 60,
+              std::min(config.send_fraction, 1.0));
+  return 0;
+}
@@ -0,0 +1,375 @@
+// Simulates the radio link from the transmitter pin to an RH_ASK receiver:
+//
+//   link_sim [-s speed] [-S speed,...] [-n frames] [-p payload_len]
+//            [-g gap_ms] [-N noise] [-f flips_per_bit] [-c clock_skew_%]
+//            [-d dropouts_per_s] [-D dropout_ms] [-a dropout_level]
+//            [-e edge_jitter_us] [-t pulse_stretch_us] [-r seed] [-m] [-F]
+//            [waveform]
+//
+// Without a waveform it sends -n frames with random payloads at the bit
+// period the firmware's Timer1 generates for -s bits/s, -g ms and up to as
+// much again apart. The waveform is the transmitter pin of the firmware in
+// simavr as energy_profile -w writes it, the frames in it are counted as
+// bursts of bits. For a waveform the tool also prints how far the edges of
+// the transmitter stray from the bit grid of their frame, the interrupt
+// latency of the firmware. The waveform path has not seen a capture from a
+// real simavr yet, energy_profile_smoke checks it once one can be made.
+//
+// The channel adds gaussian noise (-N, standard deviation on the 0/1 signal),
+// glitches inverting the signal for a bit (-f per bit), a receiver clock error
+// (-c), carrier dropouts (-d per second, -D ms long on average, -a of the
+// amplitude) and edge timing errors of the radio modules that do not scale
+// with the bit rate (-e, -t), see AskChannel.
+//
+// Prints the packet delivery ratio, the bit error rate within the frames the
+// receiver synchronised to, the frames the receiver dropped and the timing
+// margins inside frames: how far the signal transitions were from where the
+// receiver PLL expects them in percent of a bit, the share of bits whose 8
+// samples disagreed and of those decided within one sample of the threshold.
+// -m also searches the largest receiver clock error at which 99% of the
+// frames arrive. -S compares bit rates on the same channel, one line each.
+// -F also decodes the samples with the soft-decision receiver
+// (AskSoftReceiver) and prints what it delivers.
+#include "ask_link.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// low time that separates two frames of a captured waveform, 4b6b symbols
+// have no more than 4 consecutive zeros
+constexpr double FRAME_GAP_BITS = 16;
+
+// delivery ratio the clock error search keeps
+constexpr double MARGIN_DELIVERY = 0.99;
+
+struct Link {
+  AskWaveform waveform;
+  double bit_period;
+  std::vector<AskFrame> sent; // empty for captured waveforms
+  unsigned frames;
+};
+
+bool readWaveform(const char *path, Link &link) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  double time_us;
+  int level;
+  while (in >> time_us >> level) {
+    link.waveform.times.push_back(time_us / 1e6);
+    link.waveform.levels.push_back(level != 0);
+  }
+  if (link.waveform.times.empty()) {
+    std::fprintf(stderr, "%s: no transmitter edges\n", path);
+    return false;
+  }
+  link.waveform.end = link.waveform.times.back() + 1;
+
+  link.frames = 0;
+  double low_since = -1;
+  for (size_t i = 0; i < link.waveform.times.size(); i++) {
+    double t = link.waveform.times[i];
+    if (!link.waveform.levels[i])
+      low_since = t;
+    else if (low_since < 0 ||
+             t - low_since > FRAME_GAP_BITS * link.bit_period)
+      link.frames++;
+  }
+  return true;
+}
+
+// Largest spread of the edges of a frame against the bit grid started by its
+// first edge, in seconds
+double edgeSpread(const AskWaveform &waveform, double bit_period) {
+  double spread = 0, first = 0, earliest = 0, latest = 0, low_since = -1;
+  for (size_t i = 0; i < waveform.times.size(); i++) {
+    double t = waveform.times[i];
+    if (waveform.levels[i] &&
+        (low_since < 0 || t - low_since > FRAME_GAP_BITS * bit_period)) {
+      first = t;
+      earliest = latest = 0;
+    }
+    if (!waveform.levels[i])
+      low_since = t;
+    double bits = (t - first) / bit_period;
+    double offset = (bits - std::round(bits)) * bit_period;
+    earliest = std::min(earliest, offset);
+    latest = std::max(latest, offset);
+    spread = std::max(spread, latest - earliest);
+  }
+  return spread;
+}
+
+void sendFrames(Link &link, unsigned frames, unsigned payload_len,
+                double gap, std::mt19937 &rng) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<uint8_t> payload(payload_len);
+  double t = gap;
+  for (unsigned i = 0; i < frames; i++) {
+    // to, from, id and flags number the frames
+    uint8_t headers[ASK_HEADER_LEN] = {0xff, 1, uint8_t(i), uint8_t(i >> 8)};
+    for (uint8_t &byte : payload)
+      byte = rng();
+    link.sent.push_back(askModulate(link.waveform, t, link.bit_period,
+                                    headers, payload.data(), payload_len));
+    t = link.waveform.end + gap * (1 + unit(rng));
+  }
+  link.waveform.end = t;
+  link.frames = frames;
+}
+
+unsigned delivered(const Link &link, const AskLinkResult &result) {
+  if (link.sent.empty())
+    return std::min<unsigned>(result.frames.size(), link.frames);
+  return askDelivered(link.sent, result.frames);
+}
+
+double deliveryRatio(const Link &link, const AskChannel &channel,
+                     std::mt19937 &rng) {
+  AskLinkResult result =
+      askRunLink(link.waveform, link.bit_period, channel, rng);
+  return link.frames ? double(delivered(link, result)) / link.frames : 1;
+}
+
+// largest receiver clock error, faster or slower, that keeps the delivery
+// ratio
+double skewMargin(const Link &link, AskChannel channel, std::mt19937 &rng) {
+  double good = 0, bad = 0.25;
+  for (int i = 0; i < 12; i++) {
+    double skew = (good + bad) / 2;
+    channel.clock_skew = skew;
+    bool ok = deliveryRatio(link, channel, rng) >= MARGIN_DELIVERY;
+    channel.clock_skew = -skew;
+    ok = ok && deliveryRatio(link, channel, rng) >= MARGIN_DELIVERY;
+    (ok ? good : bad) = skew;
+  }
+  return good;
+}
+
+double bitErrorRate(const Link &link, const AskLinkResult &result) {
+  AskBitErrors errors = askBitErrors(link.sent, result, link.bit_period);
+  return errors.bits ? double(errors.errors) / errors.bits : 0;
+}
+
+unsigned softDelivered(const Link &link, const AskLinkResult &result) {
+  if (link.sent.empty())
+    return std::min<unsigned>(result.soft_frames.size(), link.frames);
+  return askDelivered(link.sent, result.soft_frames);
+}
+
+void printResult(const Link &link, const AskLinkResult &result, bool soft) {
+  unsigned good = delivered(link, result);
+  std::printf("delivery ratio %.3f%% (%u of %u frames), %u dropped for their "
+              "count or CRC",
+              link.frames ? 100.0 * good / link.frames : 100, good,
+              link.frames, result.bad);
+  if (!link.sent.empty())
+    std::printf(", %zu undetected errors, bit error rate %.2e",
+                result.frames.size() - good, bitErrorRate(link, result));
+  std::printf("\n");
+  if (soft) {
+    unsigned soft_good = softDelivered(link, result);
+    std::printf("soft decision %.3f%% (%u of %u frames), %u repaired",
+                link.frames ? 100.0 * soft_good / link.frames : 100,
+                soft_good, link.frames, result.soft_repaired);
+    if (!link.sent.empty())
+      std::printf(", %zu undetected errors",
+                  result.soft_frames.size() - soft_good);
+    std::printf("\n");
+  }
+
+  const AskReceiverStats &stats = result.stats;
+  uint64_t bits = 0;
+  for (uint32_t count : stats.integrator)
+    bits += count;
+  uint64_t mixed = bits - stats.integrator[0] -
+                   stats.integrator[ASK_RX_SAMPLES_PER_BIT];
+  uint64_t weak = stats.integrator[ASK_RX_ONE_THRESHOLD - 1] +
+                  stats.integrator[ASK_RX_ONE_THRESHOLD];
+  double mean_error =
+      stats.transitions ? double(stats.phase_error_sum) / stats.transitions
+                        : 0;
+  std::printf("transitions %.1f%% of a bit off on average, %.1f%% at most\n",
+              100 * mean_error / ASK_RX_RAMP_LEN,
+              100.0 * stats.max_phase_error / ASK_RX_RAMP_LEN);
+  std::printf("bits with samples on both sides %.3f%%, within one sample of "
+              "the threshold %.3f%%\n",
+              bits ? 100.0 * mixed / bits : 0, bits ? 100.0 * weak / bits : 0);
+}
+
+bool parseSpeeds(const char *list, std::vector<unsigned> &speeds) {
+  std::stringstream in(list);
+  std::string speed;
+  while (std::getline(in, speed, ',')) {
+    unsigned value = std::atoi(speed.c_str());
+    if (!value || value > 65535)
+      return false;
+    speeds.push_back(value);
+  }
+  return !speeds.empty();
+}
+
+void usage() {
+  std::fprintf(stderr, "usage: link_sim [-s speed] [-S speed,...] "
+                       "[-n frames] [-p payload_len] [-g gap_ms] [-N noise] "
+                       "[-f flips_per_bit] [-c clock_skew_%%] "
+                       "[-d dropouts_per_s] [-D dropout_ms] "
+                       "[-a dropout_level] [-e edge_jitter_us] "
+                       "[-t pulse_stretch_us] [-r seed] [-m] [-F] "
+                       "[waveform]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<unsigned> speeds;
+  unsigned frames = 1000;
+  unsigned payload_len = 5;
+  double gap_ms = 50;
+  AskChannel channel;
+  unsigned seed = 1;
+  bool margin = false;
+  bool soft = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:S:n:p:g:N:f:c:d:D:a:e:t:r:mF")) != -1) {
+    switch (opt) {
+    case 's':
+    case 'S':
+      speeds.clear();
+      if (!parseSpeeds(optarg, speeds)) {
+        usage();
+        return 2;
+      }
+      break;
+    case 'n':
+      frames = std::atoi(optarg);
+      break;
+    case 'p':
+      payload_len = std::atoi(optarg);
+      break;
+    case 'g':
+      gap_ms = std::atof(optarg);
+      break;
+    case 'N':
+      channel.noise = std::atof(optarg);
+      break;
+    case 'f':
+      channel.flip_rate = std::atof(optarg);
+      break;
+    case 'c':
+      channel.clock_skew = std::atof(optarg) / 100;
+      break;
+    case 'd':
+      channel.dropout_rate = std::atof(optarg);
+      break;
+    case 'D':
+      channel.dropout_length = std::atof(optarg) / 1000;
+      break;
+    case 'a':
+      channel.dropout_level = std::atof(optarg);
+      break;
+    case 'e':
+      channel.edge_jitter = std::atof(optarg) / 1e6;
+      break;
+    case 't':
+      channel.pulse_stretch = std::atof(optarg) / 1e6;
+      break;
+    case 'r':
+      seed = std::atoi(optarg);
+      break;
+    case 'm':
+      margin = true;
+      break;
+    case 'F':
+      soft = true;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (speeds.empty())
+    speeds.push_back(2000);
+  if (optind + 1 < argc || (optind < argc && speeds.size() > 1) ||
+      payload_len > ASK_MAX_FRAME_LEN - ASK_FRAME_OVERHEAD) {
+    usage();
+    return 2;
+  }
+
+  std::mt19937 rng(seed);
+  if (speeds.size() > 1) {
+    // the same frames and channel at every bit rate
+    std::printf("%7s %11s %12s %10s %9s %10s%s%s\n", "bit/s", "airtime ms",
+                "delivered %", "BER", "dropped", "jitter %",
+                soft ? "  soft delivered %" : "",
+                margin ? "  clock margin %" : "");
+    AskSoftOptions soft_options;
+    for (unsigned speed : speeds) {
+      Link link;
+      link.bit_period = askBitPeriod(speed);
+      std::mt19937 frame_rng(seed);
+      sendFrames(link, frames, payload_len, gap_ms / 1000, frame_rng);
+      AskLinkResult result =
+          askRunLink(link.waveform, link.bit_period, channel, rng,
+                     soft ? &soft_options : nullptr);
+      const AskReceiverStats &stats = result.stats;
+      std::printf("%7u %11.1f %12.3f %10.2e %9u %10.1f", speed,
+                  askAirtime(payload_len, link.bit_period) * 1000,
+                  100.0 * delivered(link, result) / link.frames,
+                  bitErrorRate(link, result), result.bad,
+                  stats.transitions ? 100.0 * stats.phase_error_sum /
+                                          stats.transitions / ASK_RX_RAMP_LEN
+                                    : 0);
+      if (soft)
+        std::printf("  %17.3f",
+                    100.0 * softDelivered(link, result) / link.frames);
+      if (margin)
+        std::printf("  %15.2f", 100 * skewMargin(link, channel, rng));
+      std::printf("\n");
+    }
+    return 0;
+  }
+
+  Link link;
+  link.bit_period = askBitPeriod(speeds[0]);
+  if (optind < argc) {
+    if (!readWaveform(argv[optind], link))
+      return 1;
+  } else {
+    sendFrames(link, frames, payload_len, gap_ms / 1000, rng);
+  }
+
+  std::printf("bit period %.3f us (%u bit/s)", link.bit_period * 1e6,
+              speeds[0]);
+  if (!link.sent.empty())
+    std::printf(", frame %.1f ms",
+                askAirtime(payload_len, link.bit_period) * 1000);
+  std::printf("\n");
+  if (link.sent.empty()) {
+    double spread = edgeSpread(link.waveform, link.bit_period);
+    std::printf("transmitter edges spread %.2f us (%.1f%% of a bit)\n",
+                spread * 1e6, 100 * spread / link.bit_period);
+  }
+
+  AskSoftOptions soft_options;
+  AskLinkResult result = askRunLink(link.waveform, link.bit_period, channel,
+                                    rng, soft ? &soft_options : nullptr);
+  printResult(link, result, soft);
+  if (margin)
+    std::printf("receiver clock error margin +-%.2f%% for %.0f%% delivery\n",
+                100 * skewMargin(link, channel, rng), 100 * MARGIN_DELIVERY);
+  return 0;
+}
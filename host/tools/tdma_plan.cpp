@@ -0,0 +1,246 @@
+// Checks the transmit schedule of a fleet of stations for overlaps:
+//
+//   tdma_plan [-p payload_len] [-s speed] [-w wakeups] [-c clock_error_%]
+//             [-f send_fraction] [-a degC_per_hour] [-d days] [-r runs]
+//             <station id>...
+//
+// Prints the slot and period of every station, fails if two stations share
+// a slot and simulates the fleet with random power up times (and watchdog
+// clock errors up to -c percent) to estimate the packet delivery ratio.
+// Every cycle sleeps -w wakeups and only a fraction -f of the cycles
+// transmits. -a runs the send policy of the firmware instead: each station
+// samples a temperature that wanders by the given degC per hour (a random
+// walk), sends on change and sleeps the adaptive interval of SendPolicy, so
+// the periods vary from cycle to cycle like on the stations.
+//
+// The slots keep two stations apart only while both sleep the same number of
+// wakeups. With send on change a station whose interval is (close to) a
+// multiple of another's can collide with it for as long as both intervals
+// hold, and stations sharing a slot collide until their clock errors move
+// them apart. The planner reports the longest such run.
+#include "send_policy.hpp"
+#include "tdma_schedule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr double WATCHDOG_WAKEUP_MS = 8000; // WATCHDOG_TIME
+constexpr double WAKEUPS_PER_HOUR = 3600e3 / WATCHDOG_WAKEUP_MS;
+
+// 14 bit HDC1080 codes the send policy sees, 0.01 degC each, around 20 degC
+constexpr double TEMPERATURE_CODES_PER_DEGC = 100;
+constexpr double TEMPERATURE_START = 6000;
+constexpr uint16_t HUMIDITY = 7373; // 45 %RH
+
+struct Station {
+  unsigned id;
+  double stretch; // s, added to every cycle
+  double period;  // s, at -w wakeups
+};
+
+struct Transmission {
+  double start;
+  size_t station;
+};
+
+struct Result {
+  size_t cycles = 0;
+  size_t sent = 0;
+  size_t lost = 0;
+  size_t max_consecutive_lost = 0;
+};
+
+// Cycles of a station with send on change: a temperature random walk of
+// degc_per_hour fed into the send policy, which also sets the next interval.
+void sendOnChange(const Station &station, size_t index, double clock,
+                  double degc_per_hour, double duration, std::mt19937 &rng,
+                  std::vector<Transmission> &transmissions, Result &result) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::normal_distribution<double> step(
+      0, degc_per_hour * TEMPERATURE_CODES_PER_DEGC /
+             std::sqrt(WAKEUPS_PER_HOUR));
+  SendPolicy policy;
+  double temperature = TEMPERATURE_START;
+  uint8_t wakeups = 0;
+  double t = unit(rng) * (SEND_POLICY_START_INTERVAL * WATCHDOG_WAKEUP_MS /
+                              1000 +
+                          station.stretch);
+  for (; t < duration; result.cycles++) {
+    if (policy.update(std::lround(temperature), HUMIDITY, wakeups))
+      transmissions.push_back({t, index});
+    wakeups = policy.interval();
+    for (uint8_t i = 0; i < wakeups; i++)
+      temperature = std::min(std::max(temperature + step(rng), 0.0), 16383.0);
+    t += (wakeups * WATCHDOG_WAKEUP_MS / 1000 + station.stretch) * clock;
+  }
+}
+
+Result simulate(const std::vector<Station> &stations, double airtime,
+                double clock_error, double send_fraction,
+                double degc_per_hour, double duration, std::mt19937 &rng) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<Transmission> transmissions;
+  Result result;
+  for (size_t i = 0; i < stations.size(); i++) {
+    double clock = 1 + clock_error * (2 * unit(rng) - 1);
+    if (degc_per_hour > 0) {
+      sendOnChange(stations[i], i, clock, degc_per_hour, duration, rng,
+                   transmissions, result);
+      continue;
+    }
+    double period = stations[i].period * clock;
+    for (double t = unit(rng) * period; t < duration; t += period) {
+      result.cycles++;
+      if (unit(rng) < send_fraction)
+        transmissions.push_back({t, i});
+    }
+  }
+  std::sort(transmissions.begin(), transmissions.end(),
+            [](const Transmission &a, const Transmission &b) {
+              return a.start < b.start;
+            });
+
+  std::vector<bool> lost(transmissions.size(), false);
+  for (size_t i = 1; i < transmissions.size(); i++)
+    if (transmissions[i].start - transmissions[i - 1].start < airtime)
+      lost[i] = lost[i - 1] = true;
+
+  std::vector<size_t> consecutive(stations.size(), 0);
+  for (size_t i = 0; i < transmissions.size(); i++) {
+    size_t &run = consecutive[transmissions[i].station];
+    result.sent++;
+    if (lost[i]) {
+      result.lost++;
+      run++;
+      result.max_consecutive_lost = std::max(result.max_consecutive_lost, run);
+    } else {
+      run = 0;
+    }
+  }
+  return result;
+}
+
+void usage() {
+  std::fprintf(stderr, "usage: tdma_plan [-p payload_len] [-s speed] "
+                       "[-w wakeups] [-c clock_error_%%] [-f send_fraction] "
+                       "[-a degC_per_hour] [-d days] [-r runs] "
+                       "<station id>...\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned payload_len = 5;
+  unsigned speed = 2000;
+  unsigned wakeups = 7;
+  double clock_error = 0;
+  double send_fraction = 1;
+  double degc_per_hour = 0;
+  double days = 1;
+  unsigned runs = 20;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:s:w:c:f:a:d:r:")) != -1) {
+    switch (opt) {
+    case 'p':
+      payload_len = std::atoi(optarg);
+      break;
+    case 's':
+      speed = std::atoi(optarg);
+      break;
+    case 'w':
+      wakeups = std::atoi(optarg);
+      break;
+    case 'c':
+      clock_error = std::atof(optarg) / 100;
+      break;
+    case 'f':
+      send_fraction = std::atof(optarg);
+      break;
+    case 'a':
+      degc_per_hour = std::atof(optarg);
+      break;
+    case 'd':
+      days = std::atof(optarg);
+      break;
+    case 'r':
+      runs = std::atoi(optarg);
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind == argc || !speed || payload_len > 255) {
+    usage();
+    return 2;
+  }
+
+  uint16_t airtime_ms = tdmaAirtimeMs(payload_len, speed);
+  uint8_t slot_ticks = tdmaSlotTicks(airtime_ms);
+  std::printf("airtime %u ms, slot %u ticks (%u ms), superframe %.3f s\n",
+              airtime_ms, slot_ticks, slot_ticks * TDMA_TICK_MS,
+              (wakeups * WATCHDOG_WAKEUP_MS +
+               TDMA_SLOTS * slot_ticks * TDMA_TICK_MS) /
+                  1000);
+
+  std::vector<Station> stations;
+  std::map<unsigned, unsigned> slot_owner;
+  bool overlap = false;
+  for (int i = optind; i < argc; i++) {
+    unsigned id = std::atoi(argv[i]);
+    unsigned slot = tdmaSlot(id);
+    double stretch = tdmaStretchTicks(id, slot_ticks) * TDMA_TICK_MS / 1000.0;
+    stations.push_back(
+        {id, stretch, wakeups * WATCHDOG_WAKEUP_MS / 1000 + stretch});
+    if (degc_per_hour > 0)
+      std::printf("station %3u slot %2u period %.3f to %.3f s\n", id, slot,
+                  SEND_POLICY_MIN_INTERVAL * WATCHDOG_WAKEUP_MS / 1000 +
+                      stretch,
+                  SEND_POLICY_MAX_INTERVAL * WATCHDOG_WAKEUP_MS / 1000 +
+                      stretch);
+    else
+      std::printf("station %3u slot %2u period %.3f s\n", id, slot,
+                  stations.back().period);
+
+    auto owner = slot_owner.emplace(slot, id);
+    if (!owner.second) {
+      std::printf("  overlap: shares slot %u with station %u\n", slot,
+                  owner.first->second);
+      overlap = true;
+    }
+  }
+
+  std::mt19937 rng(1);
+  Result total;
+  for (unsigned run = 0; run < runs; run++) {
+    Result result = simulate(stations, airtime_ms / 1000.0, clock_error,
+                             send_fraction, degc_per_hour, days * 86400, rng);
+    total.cycles += result.cycles;
+    total.sent += result.sent;
+    total.lost += result.lost;
+    total.max_consecutive_lost =
+        std::max(total.max_consecutive_lost, result.max_consecutive_lost);
+  }
+  std::printf("delivery ratio %.3f%% (%zu of %zu frames lost), at most %zu "
+              "consecutive frames of one station lost\n",
+              total.sent ? 100.0 * (total.sent - total.lost) / total.sent : 100,
+              total.lost, total.sent, total.max_consecutive_lost);
+  std::printf("%.1f%% of the cycles sent a frame\n",
+              total.cycles ? 100.0 * total.sent / total.cycles : 0);
+  std::printf("note: the slots only separate stations that sleep the same "
+              "number of wakeups,\n  stations in one slot or with send on "
+              "change intervals that are multiples of each other can lose "
+              "frames in a row\n");
+
+  return overlap ? 1 : 0;
+}
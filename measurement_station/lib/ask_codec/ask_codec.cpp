@@ -0,0 +1,96 @@
+#include "ask_codec.hpp"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(p) (*(p))
+#define pgm_read_word(p) (*(p))
+#endif
+
+// Standard RH_ASK preamble, 0x38, 0x2c is the start symbol
+const uint8_t ask_preamble[ASK_PREAMBLE_LEN] = {0x2a, 0x2a, 0x2a, 0x2a,
+                                                0x2a, 0x2a, 0x38, 0x2c};
+
+// 4 bit to 6 bit symbol converter table, same as RH_ASK. Each 6-bit symbol has
+// 3 1s and 3 0s with at most 3 consecutive identical bits
+const uint8_t ask_symbols[16] = {0xd,  0xe,  0x13, 0x15, 0x16, 0x19,
+                                 0x1a, 0x1c, 0x23, 0x25, 0x26, 0x29,
+                                 0x2a, 0x2c, 0x32, 0x34};
+
+// CRC-CCITT of a nybble shifted through a zero register
+static const uint16_t crc_nybbles[16] PROGMEM = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xa50a, 0xb58b, 0xc60c, 0xd68d, 0xe70e, 0xf78f};
+
+uint16_t askCrcUpdateNybbles(uint16_t crc, uint8_t data) {
+  // reflected, so the low nybble goes first
+  crc = (crc >> 4) ^ pgm_read_word(&crc_nybbles[(crc ^ data) & 0xf]);
+  return (crc >> 4) ^ pgm_read_word(&crc_nybbles[(crc ^ (data >> 4)) & 0xf]);
+}
+
+static uint8_t *encodeByte(uint8_t *p, uint8_t byte) {
+  *p++ = ask_symbols[byte >> 4];
+  *p++ = ask_symbols[byte & 0xf];
+  return p;
+}
+
+uint8_t askEncode(const uint8_t *headers, const uint8_t *data, uint8_t len,
+                  uint8_t *symbols) {
+  uint8_t *p = symbols;
+  uint8_t count = len + ASK_FRAME_OVERHEAD;
+  uint16_t crc = askCrcUpdate(0xffff, count);
+  p = encodeByte(p, count);
+
+  for (uint8_t i = 0; i < ASK_HEADER_LEN; i++) {
+    crc = askCrcUpdate(crc, headers[i]);
+    p = encodeByte(p, headers[i]);
+  }
+  for (uint8_t i = 0; i < len; i++) {
+    crc = askCrcUpdate(crc, data[i]);
+    p = encodeByte(p, data[i]);
+  }
+
+  // The receiver expects the ones complement of the CRC, low byte first
+  crc = ~crc;
+  p = encodeByte(p, crc & 0xff);
+  p = encodeByte(p, crc >> 8);
+  return p - symbols;
+}
+
+#define X ASK_INVALID_SYMBOL
+// 4 bit value of every 6 bit symbol, the reverse of ask_symbols
+static const uint8_t symbol_values[64] PROGMEM = {
+    X, X, X,  X, X,  X, X,  X, X, X,  X,  X, X,  0, 1, X,
+    X, X, X,  2, X,  3, 4,  X, X, 5,  6,  X, 7,  X, X, X,
+    X, X, X,  8, X,  9, 10, X, X, 11, 12, X, 13, X, X, X,
+    X, X, 14, X, 15, X, X,  X, X, X,  X,  X, X,  X, X, X};
+#undef X
+
+uint8_t askDecodeSymbol(uint8_t symbol) {
+  return symbol < 64 ? pgm_read_byte(&symbol_values[symbol])
+                     : ASK_INVALID_SYMBOL;
+}
+
+uint8_t askDecode(const uint8_t *symbols, uint8_t num_symbols, uint8_t *frame) {
+  uint8_t len = 0;
+  for (uint8_t i = 0; i + 1 < num_symbols; i += 2) {
+    uint8_t high = askDecodeSymbol(symbols[i]);
+    uint8_t low = askDecodeSymbol(symbols[i + 1]);
+    if (high == ASK_INVALID_SYMBOL || low == ASK_INVALID_SYMBOL)
+      return 0;
+    frame[len++] = high << 4 | low;
+    if (frame[0] < ASK_FRAME_OVERHEAD || frame[0] > ASK_MAX_FRAME_LEN)
+      return 0;
+    if (len == frame[0])
+      return len;
+  }
+  return 0;
+}
+
+bool askCheckCrc(const uint8_t *frame, uint8_t len) {
+  uint16_t crc = 0xffff;
+  for (uint8_t i = 0; i < len; i++)
+    crc = askCrcUpdate(crc, frame[i]);
+  return crc == ASK_CRC_RESIDUE;
+}
@@ -0,0 +1,77 @@
+#ifndef ASK_CODEC_HPP
+#define ASK_CODEC_HPP
+
+#include <stdint.h>
+
+// Frame coding of RadioHead ASK, shared by the transmitter and the host side
+// tools:
+//
+//   preamble and start symbol (8 symbols)
+//   [count][to][from][id][flags][payload...][crc low][crc high]
+//
+// count covers itself, the headers, the payload and the CRC. Every byte is
+// sent as two 6 bit symbols (4b6b, high nybble first), every symbol LSB first.
+// The CRC is the ones complement of CRC-CCITT (reflected 0x8408, init 0xffff)
+// over count, headers and payload.
+
+#define ASK_PREAMBLE_LEN 8
+#define ASK_HEADER_LEN 4
+
+// count byte, headers and 2 byte CRC around every payload
+#define ASK_FRAME_OVERHEAD (ASK_HEADER_LEN + 3)
+
+// largest count byte RH_ASK accepts (RH_ASK_MAX_PAYLOAD_LEN)
+#define ASK_MAX_FRAME_LEN 67
+
+// CRC over a complete frame including its CRC bytes
+#define ASK_CRC_RESIDUE 0xf0b8
+
+#define ASK_INVALID_SYMBOL 0xff
+
+extern const uint8_t ask_preamble[ASK_PREAMBLE_LEN];
+extern const uint8_t ask_symbols[16];
+
+// One step of CRC-CCITT with a 16 entry table, a nybble at a time. Smaller
+// than a byte table in flash and bit exact with askCrcUpdate().
+uint16_t askCrcUpdateNybbles(uint16_t crc, uint8_t data);
+
+// One step of CRC-CCITT as _crc_ccitt_update() of avr-libc. Its inline
+// assembly takes fewer cycles on the AVR than the table reads from flash,
+// ASK_CRC_NYBBLE_TABLE uses askCrcUpdateNybbles() instead.
+#if defined(ASK_CRC_NYBBLE_TABLE)
+inline uint16_t askCrcUpdate(uint16_t crc, uint8_t data) {
+  return askCrcUpdateNybbles(crc, data);
+}
+#elif defined(__AVR__)
+#include <util/crc16.h>
+inline uint16_t askCrcUpdate(uint16_t crc, uint8_t data) {
+  return _crc_ccitt_update(crc, data);
+}
+#else
+inline uint16_t askCrcUpdate(uint16_t crc, uint8_t data) {
+  data ^= crc & 0xff;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^
+          ((uint16_t)data << 3));
+}
+#endif
+
+// Encodes the frame after the preamble into symbols (one per byte) and returns
+// their number, 2 * (len + ASK_FRAME_OVERHEAD). headers holds to, from, id and
+// flags.
+uint8_t askEncode(const uint8_t *headers, const uint8_t *data, uint8_t len,
+                  uint8_t *symbols);
+
+// 4 bit value of a 6 bit symbol, ASK_INVALID_SYMBOL if it is none. A lookup
+// in a 64 byte table in flash.
+uint8_t askDecodeSymbol(uint8_t symbol);
+
+// Decodes symbol pairs following the start symbol into bytes. Stops after the
+// number of bytes the count byte announces. Returns the frame length (count),
+// 0 if a symbol is invalid, the count out of range or symbols too short.
+uint8_t askDecode(const uint8_t *symbols, uint8_t num_symbols, uint8_t *frame);
+
+// true if the CRC of a decoded frame of len bytes (count included) is valid
+bool askCheckCrc(const uint8_t *frame, uint8_t len);
+
+#endif
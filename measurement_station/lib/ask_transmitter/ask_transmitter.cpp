@@ -0,0 +1,37 @@
+#include "ask_transmitter.hpp"
+
+#include <string.h>
+
+AskTransmitterBase::AskTransmitterBase()
+    : _txHeaders{ASK_TX_BROADCAST_ADDRESS, ASK_TX_BROADCAST_ADDRESS, 0, 0},
+      _txBufLen(0), _txIndex(0), _txBit(0), _sending(false), _txGood(0) {
+  memcpy(_txBuf, ask_preamble, ASK_TX_PREAMBLE_LEN);
+}
+
+bool AskTransmitterBase::encode(const uint8_t *data, uint8_t len) {
+  if (len > ASK_TX_MAX_MESSAGE_LEN)
+    return false;
+
+  _txBufLen = ASK_TX_PREAMBLE_LEN +
+              askEncode(_txHeaders, data, len, _txBuf + ASK_TX_PREAMBLE_LEN);
+  _txIndex = 0;
+  _txBit = 0;
+  _sending = true;
+  return true;
+}
+
+bool AskTransmitterBase::waitPacketSent() {
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  while (_sending) {
+    // sei takes effect after the next instruction, so the bit interrupt can
+    // not slip in between the check and going to sleep
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    cli();
+  }
+  sei();
+  return true;
+}
@@ -0,0 +1,218 @@
+#ifndef ASK_TRANSMITTER_HPP
+#define ASK_TRANSMITTER_HPP
+
+#include "ask_codec.hpp"
+#include "hal.hpp"
+
+// Transmit only replacement for RH_ASK on the ATtiny85, enabled with the
+// RH_ASK_TX_ONLY build flag. Frames are bit compatible with RH_ASK (see
+// ask_codec.hpp), so any RH_ASK receiver decodes them.
+//
+// Differences to RH_ASK:
+// - Timer1 fires once per bit instead of 8 times (no receiver to oversample)
+//   and is stopped between frames
+// - bit rate and pin are template parameters, the timer setup is computed at
+//   compile time and impossible bit rates fail the build, as do bit rates
+//   the interrupt budget below does not cover. At 8 MHz that is up to about
+//   13000 bit/s, 2000, 4000, 8000 and 9600 bit/s are validated against the
+//   RH_ASK receiver (host/test/test_ask_link.cpp).
+// - no receive buffer, PLL state or 6 to 4 bit decoder
+// - the transmit buffer is sized for ASK_TX_MAX_MESSAGE_LEN
+// - waitPacketSent() idles the CPU between bit interrupts
+//
+// The interrupt handler has to be instantiated once with
+// ASK_TRANSMITTER_ISR(transmitter).
+
+// largest payload a single send() accepts
+#ifndef ASK_TX_MAX_MESSAGE_LEN
+#define ASK_TX_MAX_MESSAGE_LEN 32
+#endif
+
+#define ASK_TX_PREAMBLE_LEN ASK_PREAMBLE_LEN
+#define ASK_TX_HEADER_LEN ASK_HEADER_LEN
+#define ASK_TX_FRAME_OVERHEAD ASK_FRAME_OVERHEAD
+
+#define ASK_TX_BROADCAST_ADDRESS 0xff
+
+// Interrupt budget of the bit timer, checked against every bit rate at compile
+// time. Upper bounds for the avr-gcc -Os code in CPU cycles:
+// - ASK_TX_ISR_CYCLES: the bit interrupt from the interrupt response to reti,
+//   with the register saves and the 0..5 step shift of the bit
+// - ASK_TX_BLOCKING_CYCLES: longest time other interrupts hold the bit
+//   interrupt off while a frame goes out, the Timer0 overflow of millis() and
+//   the watchdog interrupt reading micros() during the watchdog calibration
+// The fixed delay from the compare match to the pin write moves every edge
+// alike, only the blocking time makes single edges late.
+#ifndef ASK_TX_ISR_CYCLES
+#define ASK_TX_ISR_CYCLES 100
+#endif
+#ifndef ASK_TX_BLOCKING_CYCLES
+#define ASK_TX_BLOCKING_CYCLES 150
+#endif
+
+// An edge may be late by a quarter bit, 2 of the 8 samples of an RH_ASK
+// receiver. The bit interrupt may take a quarter of the CPU, the rest goes to
+// the I2C transfers of the measurement pipelined with the frame.
+#define ASK_TX_MAX_EDGE_DELAY_DIVISOR 4
+#define ASK_TX_MAX_ISR_LOAD_PERCENT 25
+
+#if defined(__AVR__) && !defined(__AVR_ATtiny85__)
+#error AskTransmitter uses the ATtiny85 Timer1 registers
+#endif
+
+// Timer1 of the ATtiny85 is 8 bit with power of two prescalers 1..16384,
+// selected with CS13:0 = 1..15. The timer runs in CTC mode with one compare
+// match per bit.
+namespace ask_timer {
+
+// timer ticks of one bit at prescaler select value cs, rounded
+constexpr uint32_t bitTicks(uint32_t bit_cycles, uint8_t cs) {
+  return (bit_cycles + ((1UL << (cs - 1)) >> 1)) >> (cs - 1);
+}
+
+// smallest prescaler select value at which one bit fits into 256 ticks, 0 if
+// there is none
+constexpr uint8_t prescaler(uint32_t bit_cycles, uint8_t cs = 1) {
+  return cs > 15 ? 0
+                 : bitTicks(bit_cycles, cs) <= 256
+                       ? cs
+                       : prescaler(bit_cycles, cs + 1);
+}
+
+// deviation of the generated from the requested bit period in CPU cycles
+constexpr uint32_t periodError(uint32_t bit_cycles, uint8_t cs) {
+  return bitTicks(bit_cycles, cs) << (cs - 1) > bit_cycles
+             ? (bitTicks(bit_cycles, cs) << (cs - 1)) - bit_cycles
+             : bit_cycles - (bitTicks(bit_cycles, cs) << (cs - 1));
+}
+
+} // namespace ask_timer
+
+// Speed independent part: frame encoding and the transmit state
+class AskTransmitterBase {
+public:
+  void setHeaderTo(uint8_t to) { _txHeaders[0] = to; }
+  void setHeaderFrom(uint8_t from) { _txHeaders[1] = from; }
+  void setHeaderId(uint8_t id) { _txHeaders[2] = id; }
+  void setHeaderFlags(uint8_t flags) { _txHeaders[3] = flags; }
+
+  uint8_t maxMessageLength() { return ASK_TX_MAX_MESSAGE_LEN; }
+
+  // number of frames sent completely
+  uint16_t txGood() { return _txGood; }
+
+  // Sleeps in idle mode until the frame is out
+  bool waitPacketSent();
+
+protected:
+  AskTransmitterBase();
+
+  // fills the transmit buffer with the encoded frame, false if too long
+  bool encode(const uint8_t *data, uint8_t len);
+
+  // to, from, id and flags
+  uint8_t _txHeaders[ASK_TX_HEADER_LEN];
+
+  // 6 bit symbols of the frame, one per byte
+  uint8_t _txBuf[ASK_TX_PREAMBLE_LEN +
+                 2 * (ASK_TX_MAX_MESSAGE_LEN + ASK_TX_FRAME_OVERHEAD)];
+  uint8_t _txBufLen;
+  volatile uint8_t _txIndex;
+  volatile uint8_t _txBit;
+  volatile bool _sending;
+  volatile uint16_t _txGood;
+};
+
+template <uint16_t Speed, uint8_t TxPin>
+class AskTransmitter : public AskTransmitterBase {
+  static constexpr uint32_t BIT_CYCLES = F_CPU / Speed;
+  static constexpr uint8_t PRESCALER = ask_timer::prescaler(BIT_CYCLES);
+
+  static_assert(PRESCALER != 0, "bit rate too low for Timer1 at this F_CPU");
+  // the checks below only make sense with a valid prescaler
+  static constexpr uint8_t CS = PRESCALER ? PRESCALER : 1;
+  static_assert(ask_timer::bitTicks(BIT_CYCLES, CS) >= 2,
+                "bit rate too high for Timer1 at this F_CPU");
+  static_assert(ask_timer::periodError(BIT_CYCLES, CS) * 100 <= BIT_CYCLES,
+                "bit rate can not be generated within 1% at this F_CPU");
+  static_assert(ASK_TX_BLOCKING_CYCLES * ASK_TX_MAX_EDGE_DELAY_DIVISOR <=
+                    BIT_CYCLES,
+                "other interrupts delay edges by more than a quarter bit at "
+                "this bit rate");
+  static_assert(ASK_TX_ISR_CYCLES * 100 <=
+                    BIT_CYCLES * ASK_TX_MAX_ISR_LOAD_PERCENT,
+                "bit interrupt takes too much of the CPU at this bit rate");
+
+  static constexpr uint8_t TICKS = ask_timer::bitTicks(BIT_CYCLES, CS) - 1;
+
+public:
+  bool init() {
+    DDRB |= _BV(TxPin);
+    writeTx(false);
+    stopTimer();
+    return true;
+  }
+
+  // Starts sending a frame in the background. Waits for the previous frame to
+  // finish first. Returns false if the payload is too long.
+  bool send(const uint8_t *data, uint8_t len) {
+    waitPacketSent();
+    if (!encode(data, len))
+      return false;
+    startTimer();
+    return true;
+  }
+
+  // called from the Timer1 compare match interrupt, once per bit
+  void handleTimerInterrupt() {
+    // Symbols are sent LSB first. The frame is finished one bit period after
+    // the last bit went out.
+    if (_txIndex >= _txBufLen) {
+      stopTimer();
+      writeTx(false);
+      _sending = false;
+      _txGood++;
+      return;
+    }
+
+    writeTx(_txBuf[_txIndex] & (1 << _txBit));
+    if (++_txBit >= 6) {
+      _txBit = 0;
+      _txIndex++;
+    }
+  }
+
+private:
+  void startTimer() {
+    // CTC mode: the counter clears after matching OCR1C, the interrupt fires
+    // on the OCR1A compare match at the same count
+    TCCR1 = 0;
+    TCNT1 = 0;
+    OCR1C = TICKS;
+    OCR1A = TICKS;
+    TIFR = _BV(OCF1A);
+    TIMSK |= _BV(OCIE1A);
+    TCCR1 = _BV(CTC1) | PRESCALER;
+  }
+
+  void stopTimer() {
+    TCCR1 = 0; // no clock source
+    TIMSK &= ~_BV(OCIE1A);
+  }
+
+  // constant pin: compiles to a single sbi/cbi
+  void writeTx(bool value) {
+    if (value)
+      PORTB |= _BV(TxPin);
+    else
+      PORTB &= ~_BV(TxPin);
+  }
+};
+
+// Defines the Timer1 interrupt handler for a transmitter instance. Use it in
+// exactly one source file. RH_ASK defines the same vector, so only one of the
+// two drivers can be linked.
+#define ASK_TRANSMITTER_ISR(transmitter)                                       \
+  ISR(TIM1_COMPA_vect) { transmitter.handleTimerInterrupt(); }
+
+#endif
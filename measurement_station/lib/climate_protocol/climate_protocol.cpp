@@ -0,0 +1,180 @@
+#include "climate_protocol.hpp"
+
+void BitWriter::write(uint16_t value, uint8_t bits) {
+  while (bits--) {
+    uint8_t mask = 0x80 >> (_bit & 7);
+    if (mask == 0x80)
+      _buffer[_bit >> 3] = 0; // first bit of a new byte
+    if (value & (1 << bits))
+      _buffer[_bit >> 3] |= mask;
+    ++_bit;
+  }
+}
+
+uint16_t BitReader::read(uint8_t bits) {
+  uint16_t value = 0;
+  while (bits--) {
+    value <<= 1;
+    if ((_bit >> 3) >= _len) {
+      _overrun = true;
+      continue;
+    }
+    if (_buffer[_bit >> 3] & (0x80 >> (_bit & 7)))
+      value |= 1;
+    ++_bit;
+  }
+  return value;
+}
+
+uint8_t climatePackV2(const ClimateSample &sample, uint8_t *buf) {
+  BitWriter writer(buf);
+  writer.write(CLIMATE_FORMAT_V2, CLIMATE_FORMAT_TAG_BITS);
+  writer.write(sample.temperature, CLIMATE_CODE_BITS);
+  writer.write(sample.humidity, CLIMATE_CODE_BITS);
+  writer.write(sample.battery, CLIMATE_BATTERY_BITS);
+  writer.write(sample.battery >> 7, 1); // voltage bit
+  writer.write(0, 1);                   // reserved
+  return writer.length();
+}
+
+bool climateUnpackV2(const uint8_t *buf, uint8_t len, ClimateSample *sample) {
+  if (len != CLIMATE_V2_PAYLOAD_LEN ||
+      climateFormatTag(buf) != CLIMATE_FORMAT_V2)
+    return false;
+
+  BitReader reader(buf, len);
+  reader.read(CLIMATE_FORMAT_TAG_BITS);
+  sample->temperature = reader.read(CLIMATE_CODE_BITS);
+  sample->humidity = reader.read(CLIMATE_CODE_BITS);
+  sample->battery = reader.read(CLIMATE_BATTERY_BITS);
+  sample->battery |= reader.read(1) << 7;
+  return !reader.overrun();
+}
+
+// bits needed to store value as two's complement
+static uint8_t signedWidth(int16_t value) {
+  if (value == 0)
+    return 0;
+  if (value < 0)
+    value = ~value;
+  uint8_t width = 1; // sign bit
+  while (value) {
+    value >>= 1;
+    ++width;
+  }
+  return width;
+}
+
+static int16_t signExtend(uint16_t value, uint8_t width) {
+  if (width && (value & (1 << (width - 1))))
+    return (int16_t)(value | (0xffff << width));
+  return (int16_t)value;
+}
+
+uint8_t climatePackBatch(const ClimateBatchSample *samples, uint8_t count,
+                         uint8_t battery, uint8_t *buf) {
+  uint8_t temperature_width = 0;
+  uint8_t humidity_width = 0;
+  for (uint8_t i = 1; i < count; i++) {
+    uint8_t width =
+        signedWidth(samples[i].temperature - samples[0].temperature);
+    if (width > temperature_width)
+      temperature_width = width;
+    width = signedWidth(samples[i].humidity - samples[0].humidity);
+    if (width > humidity_width)
+      humidity_width = width;
+  }
+
+  BitWriter writer(buf);
+  writer.write(CLIMATE_FORMAT_V3, CLIMATE_FORMAT_TAG_BITS);
+  writer.write(count, CLIMATE_BATCH_COUNT_BITS);
+  writer.write(battery, CLIMATE_BATTERY_BITS);
+  writer.write(battery >> 7, 1); // voltage bit
+  writer.write(samples[0].temperature, CLIMATE_CODE_BITS);
+  writer.write(samples[0].humidity, CLIMATE_CODE_BITS);
+  writer.write(temperature_width, CLIMATE_BATCH_WIDTH_BITS);
+  writer.write(humidity_width, CLIMATE_BATCH_WIDTH_BITS);
+  for (uint8_t i = 1; i < count; i++) {
+    writer.write(samples[i].offset, CLIMATE_BATCH_OFFSET_BITS);
+    writer.write(samples[i].temperature - samples[0].temperature,
+                 temperature_width);
+    writer.write(samples[i].humidity - samples[0].humidity, humidity_width);
+  }
+
+  // format 1 is told apart by its length only, CLIMATE_BATCH_MAX_LEN(2) is
+  // already 12 bytes
+  uint8_t len = writer.length();
+  while (len == CLIMATE_V1_PAYLOAD_LEN ||
+         len == CLIMATE_V1_STACK_COUNTING_PAYLOAD_LEN)
+    buf[len++] = 0;
+  return len;
+}
+
+bool climateUnpackBatch(const uint8_t *buf, uint8_t len,
+                        ClimateBatchSample *samples, uint8_t *count,
+                        uint8_t *battery) {
+  if (len < 1 || climateFormatTag(buf) != CLIMATE_FORMAT_V3)
+    return false;
+
+  BitReader reader(buf, len);
+  reader.read(CLIMATE_FORMAT_TAG_BITS);
+  *count = reader.read(CLIMATE_BATCH_COUNT_BITS);
+  *battery = reader.read(CLIMATE_BATTERY_BITS);
+  *battery |= reader.read(1) << 7;
+  if (*count == 0)
+    return false;
+
+  samples[0].temperature = reader.read(CLIMATE_CODE_BITS);
+  samples[0].humidity = reader.read(CLIMATE_CODE_BITS);
+  samples[0].offset = 0;
+  uint8_t temperature_width = reader.read(CLIMATE_BATCH_WIDTH_BITS);
+  uint8_t humidity_width = reader.read(CLIMATE_BATCH_WIDTH_BITS);
+  for (uint8_t i = 1; i < *count; i++) {
+    samples[i].offset = reader.read(CLIMATE_BATCH_OFFSET_BITS);
+    samples[i].temperature =
+        samples[0].temperature +
+        signExtend(reader.read(temperature_width), temperature_width);
+    samples[i].humidity =
+        samples[0].humidity +
+        signExtend(reader.read(humidity_width), humidity_width);
+  }
+  return !reader.overrun();
+}
+
+uint8_t climateBatchOffset(int32_t *elapsed_ms, uint16_t wakeup_ms) {
+  const int32_t max_offset = (1 << CLIMATE_BATCH_OFFSET_BITS) - 1;
+  int32_t offset = (*elapsed_ms + wakeup_ms / 2) / wakeup_ms;
+  if (offset > max_offset) {
+    *elapsed_ms = 0;
+    return max_offset;
+  }
+  *elapsed_ms -= offset * wakeup_ms;
+  return offset;
+}
+
+uint8_t climatePackDrift(uint16_t watchdog_tick_us) {
+  int16_t drift = (int16_t)(watchdog_tick_us - CLIMATE_WATCHDOG_TICK_US) /
+                  CLIMATE_DRIFT_STEP_US;
+  if (drift > 127)
+    drift = 127;
+  else if (drift < -127)
+    drift = -127;
+  return (uint8_t)drift;
+}
+
+uint8_t climateBatteryVoltage(uint16_t millivolts) {
+  uint16_t steps = millivolts < CLIMATE_BATTERY_MV_MIN
+                       ? 0
+                       : (millivolts - CLIMATE_BATTERY_MV_MIN) /
+                             CLIMATE_BATTERY_MV_STEP;
+  if (steps > (1 << CLIMATE_BATTERY_BITS) - 1)
+    steps = (1 << CLIMATE_BATTERY_BITS) - 1;
+  return CLIMATE_BATTERY_VOLTAGE | steps;
+}
+
+uint16_t climateBatteryMillivolts(uint8_t battery) {
+  if (!(battery & CLIMATE_BATTERY_VOLTAGE))
+    return 0;
+  return CLIMATE_BATTERY_MV_MIN +
+         (battery & ~CLIMATE_BATTERY_VOLTAGE) * CLIMATE_BATTERY_MV_STEP;
+}
@@ -0,0 +1,158 @@
+#ifndef CLIMATE_PROTOCOL_HPP
+#define CLIMATE_PROTOCOL_HPP
+
+#include <stdint.h>
+
+// Payload formats understood by the receiver.
+//
+// Format 1 is the plain DataPackage struct of the firmware (two floats, battery
+// level and station id). It carries no tag and is recognised by its length.
+// All later formats are bit-packed, MSB first, and start with a 3 bit format
+// tag. The station id travels in the RadioHead FROM header instead of the
+// payload.
+#define CLIMATE_FORMAT_V1 1
+#define CLIMATE_FORMAT_V2 2
+#define CLIMATE_FORMAT_V3 3
+
+#define CLIMATE_FORMAT_TAG_BITS 3
+
+// format 1 payload lengths, without and with USE_STACK_COUNTING
+#define CLIMATE_V1_PAYLOAD_LEN 10
+#define CLIMATE_V1_STACK_COUNTING_PAYLOAD_LEN 11
+
+// Format 2: a single sample with the raw 14 bit HDC1080 codes
+//   [tag:3][temperature:14][humidity:14][battery:7][voltage:1][reserved:1]
+//   = 40 bits
+#define CLIMATE_CODE_BITS 14
+#define CLIMATE_BATTERY_BITS 7
+#define CLIMATE_V2_PAYLOAD_LEN 5
+
+// Format 3: a batch of samples in one frame, oldest first
+//   [tag:3][count:5][battery:7][voltage:1]
+//   [temperature:14][humidity:14]               first sample
+//   [temperature width:4][humidity width:4]
+//   count - 1 times:
+//   [offset:8][temperature delta:tw][humidity delta:hw]
+// Deltas are two's complement differences to the first sample, the widths are
+// the smallest that fit all deltas of the frame. The offset is the time since
+// the previous sample in watchdog wakeups, including the TDMA stretch of the
+// sleep cycles in between, see climateBatchOffset(). The last sample is taken
+// right before the frame is sent. Batches that would be as long as a format 1
+// payload are padded with zero bytes to CLIMATE_V1_STACK_COUNTING_PAYLOAD_LEN
+// + 1, only batches of 2 or more samples get that long.
+#define CLIMATE_BATCH_COUNT_BITS 5
+#define CLIMATE_BATCH_WIDTH_BITS 4
+#define CLIMATE_BATCH_OFFSET_BITS 8
+#define CLIMATE_BATCH_MAX_SAMPLES ((1 << CLIMATE_BATCH_COUNT_BITS) - 1)
+
+// worst case payload length of a batch with n samples (15 bit deltas)
+#define CLIMATE_BATCH_MAX_LEN(n)                                               \
+  ((52 + ((n)-1) * (CLIMATE_BATCH_OFFSET_BITS + 2 * (CLIMATE_CODE_BITS + 1)) + \
+    7) /                                                                       \
+   8)
+
+// The RadioHead ID header carries the watchdog drift of the station: the
+// deviation of its measured 16ms watchdog timeout from the nominal one in 0.1%
+// steps, two's complement. 0 means nominal or not measured.
+#define CLIMATE_WATCHDOG_TICK_US 16000
+#define CLIMATE_DRIFT_STEP_US (CLIMATE_WATCHDOG_TICK_US / 1000)
+
+// The battery field is a percentage, or with the voltage bit set the supply
+// voltage as (mV - CLIMATE_BATTERY_MV_MIN) / CLIMATE_BATTERY_MV_STEP, which
+// covers 1800 to 4340 mV. In memory the voltage bit is bit 7 of the battery
+// byte.
+#define CLIMATE_BATTERY_VOLTAGE 0x80
+#define CLIMATE_BATTERY_MV_MIN 1800
+#define CLIMATE_BATTERY_MV_STEP 20
+
+// Writes values of up to 16 bits MSB first into a byte buffer.
+class BitWriter {
+public:
+  BitWriter(uint8_t *buffer) : _buffer(buffer), _bit(0) {}
+
+  void write(uint16_t value, uint8_t bits);
+
+  // number of bytes touched so far
+  uint8_t length() const { return (_bit + 7) >> 3; }
+
+private:
+  uint8_t *_buffer;
+  uint16_t _bit;
+};
+
+// Reads values written by BitWriter. Reading past the end yields zeros and
+// sets the overrun flag.
+class BitReader {
+public:
+  BitReader(const uint8_t *buffer, uint8_t len)
+      : _buffer(buffer), _len(len), _bit(0), _overrun(false) {}
+
+  uint16_t read(uint8_t bits);
+
+  bool overrun() const { return _overrun; }
+
+private:
+  const uint8_t *_buffer;
+  uint8_t _len;
+  uint16_t _bit;
+  bool _overrun;
+};
+
+// One measurement as the HDC1080 reports it: 14 bit codes (the register value
+// shifted right by 2) and the battery level in percent or as voltage.
+struct ClimateSample {
+  uint16_t temperature;
+  uint16_t humidity;
+  uint8_t battery;
+};
+
+struct ClimateBatchSample {
+  uint16_t temperature;
+  uint16_t humidity;
+  uint8_t offset; // time since the previous sample in watchdog wakeups
+};
+
+// Packs a sample into a format 2 payload, buf needs CLIMATE_V2_PAYLOAD_LEN
+// bytes. Returns the payload length.
+uint8_t climatePackV2(const ClimateSample &sample, uint8_t *buf);
+
+// Returns false if buf is not a valid format 2 payload.
+bool climateUnpackV2(const uint8_t *buf, uint8_t len, ClimateSample *sample);
+
+// Packs count samples (1..CLIMATE_BATCH_MAX_SAMPLES) into a format 3 payload,
+// buf needs CLIMATE_BATCH_MAX_LEN(count) bytes. Returns the payload length,
+// never that of a format 1 payload.
+uint8_t climatePackBatch(const ClimateBatchSample *samples, uint8_t count,
+                         uint8_t battery, uint8_t *buf);
+
+// samples needs room for CLIMATE_BATCH_MAX_SAMPLES. Returns false if buf is not
+// a valid format 3 payload.
+bool climateUnpackBatch(const uint8_t *buf, uint8_t len,
+                        ClimateBatchSample *samples, uint8_t *count,
+                        uint8_t *battery);
+
+// Offset of a batched sample: *elapsed_ms, the time since the previous batched
+// sample, rounded to whole wakeups of wakeup_ms. The rounding error stays in
+// *elapsed_ms for the next sample, so it does not add up over a batch: the
+// timestamps the receiver walks back from the offsets are off by less than
+// one wakeup. Saturates at the field range and drops the rest then.
+uint8_t climateBatchOffset(int32_t *elapsed_ms, uint16_t wakeup_ms);
+
+// battery byte for a supply voltage in mV, saturates at the field range
+uint8_t climateBatteryVoltage(uint16_t millivolts);
+
+// supply voltage in mV of a battery byte, 0 if it holds a percentage
+uint16_t climateBatteryMillivolts(uint8_t battery);
+
+// ID header for a measured watchdog timeout in us, saturates at +-12.7%
+uint8_t climatePackDrift(uint16_t watchdog_tick_us);
+
+// watchdog drift in 0.1% from the ID header
+inline int8_t climateUnpackDrift(uint8_t id_header) { return (int8_t)id_header; }
+
+// Format tag of a bit-packed payload
+inline uint8_t climateFormatTag(const uint8_t *buf) {
+  return buf[0] >> (8 - CLIMATE_FORMAT_TAG_BITS);
+}
+
+#endif
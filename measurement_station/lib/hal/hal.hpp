@@ -0,0 +1,53 @@
+#ifndef HAL_HPP
+#define HAL_HPP
+
+// Register, interrupt and sleep access for the portable parts of the firmware.
+// On the AVR these are the avr-libc headers. Native builds (unit tests and
+// benchmarks on the dev box) get plain variables for the registers in use and
+// a hook that stands in for the interrupts which would wake the CPU from
+// sleep.
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#else
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
+// ATtiny85 port B and Timer1
+extern volatile uint8_t PORTB, DDRB, PINB;
+extern volatile uint8_t TCCR1, TCNT1, OCR1A, OCR1C, TIFR, TIMSK;
+
+enum { PB0, PB1, PB2, PB3, PB4, PB5 };
+enum { CTC1 = 7, OCF1A = 6, OCIE1A = 6 };
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_ADC 1
+#define SLEEP_MODE_PWR_DOWN 2
+
+// Called for every sleep_cpu(). Tests run the interrupt handlers from it that
+// would have woken the CPU.
+extern void (*hal_sleep_hook)();
+
+inline void cli() {}
+inline void sei() {}
+inline void set_sleep_mode(uint8_t) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+inline void sleep_cpu() {
+  if (hal_sleep_hook)
+    hal_sleep_hook();
+}
+
+#define ISR(vector) extern "C" void vector()
+#endif
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __AVR__
+#include "hal.hpp"
+
+volatile uint8_t PORTB, DDRB, PINB;
+volatile uint8_t TCCR1, TCNT1, OCR1A, OCR1C, TIFR, TIMSK;
+
+void (*hal_sleep_hook)();
+#endif
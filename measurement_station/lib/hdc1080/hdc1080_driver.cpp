@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include <avr/sleep.h>
 #include <hdc1080_driver.hpp>
 #include <usi_i2c_master.h>
 
@@ -23,37 +24,93 @@
 #define HDC1080_CONFIG_HUMIDITY_RESOLUTION_HBIT 0x0200
 #define HDC1080_CONFIG_HUMIDITY_RESOLUTION_LBIT 0x0100
 
-#define HDC1080_CONFIG_TEMPERATURE_RESOLUTION_14BIT 0x0000
-#define HDC1080_CONFIG_TEMPERATURE_RESOLUTION_11BIT 0x0400
+// Conversion times in us (datasheet table 7.5)
+#define HDC1080_TEMPERATURE_CONVERSION_14BIT 6350
+#define HDC1080_TEMPERATURE_CONVERSION_11BIT 3650
+#define HDC1080_HUMIDITY_CONVERSION_14BIT 6500
+#define HDC1080_HUMIDITY_CONVERSION_11BIT 3850
+#define HDC1080_HUMIDITY_CONVERSION_8BIT 2500
 
-#define HDC1080_CONFIG_HUMIDITY_RESOLUTION_14BIT 0x0000
-#define HDC1080_CONFIG_HUMIDITY_RESOLUTION_11BIT 0x0100
-#define HDC1080_CONFIG_HUMIDITY_RESOLUTION_8BIT 0x0200
+HDC1080I2CDriver::HDC1080I2CDriver(uint16_t temperature_resolution,
+                                   uint16_t humidity_resolution) {
+  // temperature and humidity are acquired in sequence with one trigger
+  uint16_t config = HDC1080_CONFIG_ACQUISITION_MODE |
+                    (temperature_resolution &
+                     HDC1080_CONFIG_TEMPERATURE_RESOLUTION) |
+                    (humidity_resolution &
+                     (HDC1080_CONFIG_HUMIDITY_RESOLUTION_HBIT |
+                      HDC1080_CONFIG_HUMIDITY_RESOLUTION_LBIT));
 
-HDC1080I2CDriver::HDC1080I2CDriver(bool use_14bit_conversion) {
   i2c_buffer[0] = HDC1080_CONFIGURATION_REGISTER;
-  i2c_buffer[1] = 0x10;
-  i2c_buffer[2] = 0x00;
+  i2c_buffer[1] = config >> 8;
+  i2c_buffer[2] = config & 0xff;
   i2c_buffer[3] = 0x00;
+
+  conversion_time_us =
+      (config & HDC1080_CONFIG_TEMPERATURE_RESOLUTION)
+          ? HDC1080_TEMPERATURE_CONVERSION_11BIT
+          : HDC1080_TEMPERATURE_CONVERSION_14BIT;
+  if (config & HDC1080_CONFIG_HUMIDITY_RESOLUTION_HBIT)
+    conversion_time_us += HDC1080_HUMIDITY_CONVERSION_8BIT;
+  else if (config & HDC1080_CONFIG_HUMIDITY_RESOLUTION_LBIT)
+    conversion_time_us += HDC1080_HUMIDITY_CONVERSION_11BIT;
+  else
+    conversion_time_us += HDC1080_HUMIDITY_CONVERSION_14BIT;
 }
 
 void HDC1080I2CDriver::init() { i2c_send(HDC1080_I2C_ADDRESS, i2c_buffer, 3); }
 
-ClimateData HDC1080I2CDriver::measure() {
-  // trigger a measurement
-  i2c_buffer[0] = 0x00;
-  i2c_send(HDC1080_I2C_ADDRESS, i2c_buffer, 1);
+bool HDC1080I2CDriver::startMeasurement() {
+  // pointing to the temperature register triggers a measurement
+  i2c_buffer[0] = HDC1080_TEMPERATURE_REGISTER;
+  return i2c_send(HDC1080_I2C_ADDRESS, i2c_buffer, 1);
+}
+
+void HDC1080I2CDriver::waitForConversion() {
+  // idle sleep, the timer 0 overflow interrupt behind micros() wakes us up
+  // every few hundred us while the sensor converts
+  unsigned long start = micros();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (micros() - start < conversion_time_us)
+    sleep_mode();
+}
 
-  // datasheet: 14 bit measurements take about 6ms + 6ms -> 20ms
-  delay(20);
+bool HDC1080I2CDriver::measureRaw(ClimateDataRaw *raw) {
+  if (!startMeasurement())
+    return false;
+  waitForConversion();
+  return readMeasurement(raw);
+}
 
+bool HDC1080I2CDriver::readMeasurement(ClimateDataRaw *raw) {
   // receive the temperature and humidity:
   // 1 address byte + 2 byte temperature + 2 byte humidity
-  i2c_receive(HDC1080_I2C_ADDRESS, i2c_buffer, 4);
+  if (!i2c_receive(HDC1080_I2C_ADDRESS, i2c_buffer, 4))
+    return false;
 
-  uint16_t temperature = (i2c_buffer[0] << 8) + i2c_buffer[1];
-  uint16_t humidity = (i2c_buffer[2] << 8) + i2c_buffer[3];
+  *raw = ClimateDataRaw{(uint16_t)((i2c_buffer[0] << 8) + i2c_buffer[1]),
+                        (uint16_t)((i2c_buffer[2] << 8) + i2c_buffer[3])};
+  return true;
+}
 
-  return ClimateData{((float)temperature / 65536) * 165 - 40,
-                     ((float)humidity / 65536) * 100};
-}
\ No newline at end of file
+#ifndef HDC1080_NO_FLOAT
+bool HDC1080I2CDriver::measure(ClimateData *data) {
+  ClimateDataRaw raw;
+  if (!measureRaw(&raw))
+    return false;
+
+  *data = ClimateData{((float)raw.temperature / 65536) * 165 - 40,
+                      ((float)raw.humidity / 65536) * 100};
+  return true;
+}
+#endif
+
+bool HDC1080I2CDriver::measureFixed(ClimateDataFixed *data) {
+  ClimateDataRaw raw;
+  if (!measureRaw(&raw))
+    return false;
+
+  *data = ClimateDataFixed{toCentiCelsius(raw.temperature),
+                           toCentiPercent(raw.humidity)};
+  return true;
+}
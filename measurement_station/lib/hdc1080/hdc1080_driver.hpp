@@ -1,17 +1,74 @@
-#include <Arduino.h>
+#include <stdint.h>
 
+// Resolution settings of the configuration register
+#define HDC1080_CONFIG_TEMPERATURE_RESOLUTION_14BIT 0x0000
+#define HDC1080_CONFIG_TEMPERATURE_RESOLUTION_11BIT 0x0400
+
+#define HDC1080_CONFIG_HUMIDITY_RESOLUTION_14BIT 0x0000
+#define HDC1080_CONFIG_HUMIDITY_RESOLUTION_11BIT 0x0100
+#define HDC1080_CONFIG_HUMIDITY_RESOLUTION_8BIT 0x0200
+
+// Define HDC1080_NO_FLOAT to drop the float interface and keep the AVR soft
+// float library out of the firmware.
+#ifndef HDC1080_NO_FLOAT
 struct ClimateData {
   float temperature;
   float humidity;
 };
+#endif
+
+// fixed point values: temperature in 0.01 degree C, humidity in 0.01 %RH
+struct ClimateDataFixed {
+  int16_t temperature;
+  uint16_t humidity;
+};
+
+// raw register values as read from the sensor
+struct ClimateDataRaw {
+  uint16_t temperature;
+  uint16_t humidity;
+};
 
 class HDC1080I2CDriver {
 public:
-  HDC1080I2CDriver(bool use_14bit_conversion = true);
+  HDC1080I2CDriver(
+      uint16_t temperature_resolution =
+          HDC1080_CONFIG_TEMPERATURE_RESOLUTION_14BIT,
+      uint16_t humidity_resolution = HDC1080_CONFIG_HUMIDITY_RESOLUTION_14BIT);
 
   void init();
-  ClimateData measure();
+
+  // Split measurement: trigger the conversion, let the caller sleep for at
+  // least conversionTime() microseconds, then read the result. Both return
+  // false if the sensor did not acknowledge or the bus timed out, raw is left
+  // as it was then.
+  bool startMeasurement();
+  bool readMeasurement(ClimateDataRaw *raw);
+  uint16_t conversionTime() const { return conversion_time_us; }
+
+  // The measure functions below wait for the conversion in idle sleep and
+  // return false like the split measurement
+#ifndef HDC1080_NO_FLOAT
+  bool measure(ClimateData *data);
+#endif
+  bool measureRaw(ClimateDataRaw *raw);
+  bool measureFixed(ClimateDataFixed *data);
+
+  // integer conversions of the raw register values, also built natively
+
+  // T = raw / 2^16 * 165 - 40, scaled by 100 to keep two decimals
+  static int16_t toCentiCelsius(uint16_t raw_temperature) {
+    return (int16_t)(((uint32_t)raw_temperature * 16500) >> 16) - 4000;
+  }
+
+  // RH = raw / 2^16 * 100, scaled by 100 to keep two decimals
+  static uint16_t toCentiPercent(uint16_t raw_humidity) {
+    return ((uint32_t)raw_humidity * 10000) >> 16;
+  }
 
 private:
+  void waitForConversion();
+
   uint8_t i2c_buffer[4];
+  uint16_t conversion_time_us;
 };
\ No newline at end of file
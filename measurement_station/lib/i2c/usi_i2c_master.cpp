@@ -44,10 +44,37 @@
 #define USI_SET_SCL_LOW()                                                      \
   { PORT_USI &= ~(1 << PORT_USI_SCL); }
 
+// _delay_us() counts cycles of F_CPU. Count the delay loops (3 cycles each)
+// at runtime instead and scale them by the active clock prescaler (CLKPR), so
+// the bus timing also holds when the CPU clock is divided down.
+#define I2C_DELAY_LOOPS(us) ((uint8_t)((us) * (F_CPU / 1000000UL) / 3) + 1)
+
+static inline void i2c_delay(uint8_t loops) {
+  loops >>= CLKPR & 0x0F;
+  if (loops)
+    _delay_loop_1(loops);
+}
+
 #define USI_I2C_WAIT_HIGH()                                                    \
-  { _delay_us(I2C_THIGH); }
+  { i2c_delay(I2C_DELAY_LOOPS(I2C_THIGH)); }
 #define USI_I2C_WAIT_LOW()                                                     \
-  { _delay_us(I2C_TLOW); }
+  { i2c_delay(I2C_DELAY_LOOPS(I2C_TLOW)); }
+
+// Every wait for a released line gives up after I2C_TIMEOUT_POLLS polls (~1ms
+// at 8 MHz, proportionally longer at a divided clock). A timed out transfer
+// sets i2c_bus_error and the bus gets recovered.
+static uint8_t i2c_bus_error;
+
+static uint8_t i2c_wait_released(uint8_t pin) {
+  uint16_t polls = I2C_TIMEOUT_POLLS;
+  while (!(PIN_USI & (1 << pin))) {
+    if (!--polls) {
+      i2c_bus_error = 1;
+      return 0;
+    }
+  }
+  return 1;
+}
 
 /////////////////////////////////////////////////////////////////////
 // USI_I2C_Master_Transfer                                         //
@@ -61,8 +88,8 @@ uint8_t USI_I2C_Master_Transfer(uint8_t USISR_temp) {
   do {
     USI_I2C_WAIT_LOW();
     USI_CLOCK_STROBE(); // SCL Positive Edge
-    while (!(PIN_USI & (1 << PIN_USI_SCL)))
-      ; // Wait for SCL to go high
+    if (!i2c_wait_released(PIN_USI_SCL)) // Wait for SCL to go high
+      return 0;
     USI_I2C_WAIT_HIGH();
     USI_CLOCK_STROBE();               // SCL Negative Edge
   } while (!(USISR & (1 << USIOIF))); // Do until transfer is complete
@@ -72,11 +99,11 @@ uint8_t USI_I2C_Master_Transfer(uint8_t USISR_temp) {
   return USIDR;
 }
 
-void create_start_condition() {
+uint8_t create_start_condition() {
   USI_SET_SCL_HIGH(); // Setting input makes line pull high
 
-  while (!(PIN_USI & (1 << PIN_USI_SCL)))
-    ; // Wait for SCL to go high
+  if (!i2c_wait_released(PIN_USI_SCL)) // Wait for SCL to go high
+    return 0;
 
 #ifdef I2C_FAST_MODE
   USI_I2C_WAIT_HIGH();
@@ -90,6 +117,7 @@ void create_start_condition() {
   USI_SET_SCL_LOW();
   USI_I2C_WAIT_LOW();
   USI_SET_SDA_HIGH();
+  return 1;
 }
 
 void send_stop_condition() {
@@ -99,14 +127,44 @@ void send_stop_condition() {
 
   USI_SET_SCL_INPUT(); // Release SCL.
 
-  while (!(PIN_USI & (1 << PIN_USI_SCL)))
-    ; // Wait for SCL to go high.
+  i2c_wait_released(PIN_USI_SCL); // Wait for SCL to go high.
 
   USI_I2C_WAIT_HIGH();
   USI_SET_SDA_INPUT(); // Release SDA.
 
-  while (!(PIN_USI & (1 << PIN_USI_SDA)))
-    ; // Wait for SDA to go high.
+  i2c_wait_released(PIN_USI_SDA); // Wait for SDA to go high.
+}
+
+void i2c_recover() {
+  // Take the USI out of the way and clock by hand, open drain style: the port
+  // bits stay low and the direction bits pull a line low or release it. A
+  // slave stuck in the middle of a read releases SDA after at most 9 clocks,
+  // then a stop condition resets the slave state machines.
+  USICR = 0;
+  USI_SET_SDA_INPUT();
+  USI_SET_SDA_LOW();
+  USI_SET_SCL_LOW();
+  for (uint8_t i = 0; i < 9 && !(PIN_USI & (1 << PIN_USI_SDA)); i++) {
+    USI_SET_SCL_OUTPUT();
+    USI_I2C_WAIT_LOW();
+    USI_SET_SCL_INPUT();
+    i2c_wait_released(PIN_USI_SCL);
+    USI_I2C_WAIT_HIGH();
+  }
+
+  // stop condition: SDA rises while SCL is high
+  USI_SET_SCL_OUTPUT();
+  USI_SET_SDA_OUTPUT();
+  USI_I2C_WAIT_LOW();
+  USI_SET_SCL_INPUT();
+  i2c_wait_released(PIN_USI_SCL);
+  USI_I2C_WAIT_HIGH();
+  USI_SET_SDA_INPUT();
+  USI_I2C_WAIT_LOW();
+
+  USI_SET_SCL_HIGH();
+  USI_SET_SDA_HIGH();
+  i2c_bus_error = 0;
 }
 
 uint8_t send_byte(uint8_t data) {
@@ -121,12 +179,14 @@ uint8_t send_byte(uint8_t data) {
   USIDR = data; // Load data
 
   USI_I2C_Master_Transfer(USISR_TRANSFER_8_BIT);
+  if (i2c_bus_error) {
+    return 0;
+  }
 
   USI_SET_SDA_INPUT();
 
-  if (USI_I2C_Master_Transfer(USISR_TRANSFER_1_BIT) & 0x01) {
-    USI_SET_SCL_HIGH();
-    USI_SET_SDA_HIGH();
+  if ((USI_I2C_Master_Transfer(USISR_TRANSFER_1_BIT) & 0x01) ||
+      i2c_bus_error) {
     return 0;
   }
 
@@ -134,30 +194,54 @@ uint8_t send_byte(uint8_t data) {
   return 1;
 }
 
+// ends a failed transfer: recovers a timed out bus, releases it after a NACK
+static uint8_t i2c_abort() {
+  if (!i2c_bus_error) {
+    USI_SET_SDA_OUTPUT();
+    send_stop_condition();
+  }
+  if (i2c_bus_error) { // also if the stop condition timed out
+    i2c_recover();
+  }
+  return 0;
+}
+
 uint8_t i2c_send(const uint8_t address, const uint8_t *message_buffer,
                  uint8_t bytes_to_send) {
-  create_start_condition();
+  i2c_bus_error = 0;
+  if (!create_start_condition()) {
+    return i2c_abort();
+  }
 
   if (!send_byte((address << 1) | 0x00)) {
-    return 0;
+    return i2c_abort();
   }
 
   do {
     if (!send_byte(*message_buffer)) {
-      return 0;
+      return i2c_abort();
     }
     ++message_buffer;
   } while (--bytes_to_send);
 
   send_stop_condition();
+  if (i2c_bus_error) {
+    return i2c_abort();
+  }
   return 1;
 }
 
-void i2c_receive(const uint8_t address, uint8_t *message_buffer,
-                 uint8_t bytes_to_receive) {
-  create_start_condition();
+uint8_t i2c_receive(const uint8_t address, uint8_t *message_buffer,
+                    uint8_t bytes_to_receive) {
+  i2c_bus_error = 0;
+  if (!create_start_condition()) {
+    return i2c_abort();
+  }
 
-  send_byte((address << 1) | 0x01);
+  // the HDC1080 NACKs its address while a conversion is still running
+  if (!send_byte((address << 1) | 0x01)) {
+    return i2c_abort();
+  }
 
   do {
     ///////////////////////////////////////////////////////////////////
@@ -177,9 +261,15 @@ void i2c_receive(const uint8_t address, uint8_t *message_buffer,
     }
 
     USI_I2C_Master_Transfer(USISR_TRANSFER_1_BIT);
+    if (i2c_bus_error) {
+      return i2c_abort();
+    }
     ++message_buffer;
   } while (--bytes_to_receive); // Do until all data is read/written
 
   send_stop_condition();
-  return;
-}
\ No newline at end of file
+  if (i2c_bus_error) {
+    return i2c_abort();
+  }
+  return 1;
+}
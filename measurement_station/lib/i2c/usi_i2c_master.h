@@ -14,7 +14,7 @@
 
 #include <Arduino.h>
 #include <avr/io.h>
-#include <util/delay.h>
+#include <util/delay_basic.h>
 
 // I2C Bus Specification v2.1 FAST mode timing limits
 #ifdef I2C_FAST_MODE
@@ -27,6 +27,11 @@
 #define I2C_THIGH 4.0
 #endif
 
+// polls of a line before a transfer is given up (~1ms at 8 MHz)
+#ifndef I2C_TIMEOUT_POLLS
+#define I2C_TIMEOUT_POLLS 1000
+#endif
+
 // Microcontroller Dependent Definitions
 #if defined(__AVR_ATtiny24__) | defined(__AVR_ATtiny44__) |                    \
     defined(__AVR_ATtiny84__)
@@ -39,6 +44,17 @@
 #define PIN_USI_SCL PINA4
 #endif
 
+#if defined(__AVR_ATtiny25__) | defined(__AVR_ATtiny45__) |                    \
+    defined(__AVR_ATtiny85__)
+#define DDR_USI DDRB
+#define PORT_USI PORTB
+#define PIN_USI PINB
+#define PORT_USI_SDA PB0
+#define PORT_USI_SCL PB2
+#define PIN_USI_SDA PINB0
+#define PIN_USI_SCL PINB2
+#endif
+
 #if defined(__AVR_AT90Tiny2313__) | defined(__AVR_ATtiny2313__)
 #define DDR_USI DDRB
 #define PORT_USI PORTB
@@ -49,10 +65,29 @@
 #define PIN_USI_SCL PINB7
 #endif
 
+// The transfers are polled, not driven by the USI overflow interrupt. In two
+// wire master mode only a USITC write toggles SCL, so every clock edge needs
+// the CPU. Hand counted from the AVR instruction timings:
+// - polled bit: ~47 cycles at 8 MHz (I2C_FAST_MODE delays included), ~52 at
+//   the 1 MHz of PowerManager where the delays shift to zero
+// - interrupt per edge: 4 response + 2 vector + ~9 prologue + 2 USITC + ~9
+//   epilogue + 4 reti = ~30 cycles, ~60 per bit, so no time to idle sleep in
+// - no timer left to pace the edges: Timer0 runs millis()/micros(), Timer1
+//   the radio bit timer while the pipelined measurement reads the sensor
+// A sample moves 7 bytes (pointer write, 4 byte read), ~0.12 ms at 8 MHz plus
+// ~2.7 ms at 1 MHz. Sleeping all of it in idle instead of running would save
+// (330 - 80) uA * 2.7 ms = ~0.7 uC, against ~220 uC of power down per 56 s
+// sample interval: below 0.3%.
+
+// Both return 1 on success and 0 if the slave did not acknowledge or the bus
+// timed out. A timed out bus is recovered before they return.
 uint8_t i2c_send(const uint8_t address, const uint8_t *message_buffer,
                  uint8_t bytes_to_send);
 
-void i2c_receive(const uint8_t address, uint8_t *message_buffer,
-                 uint8_t bytes_to_receive);
+uint8_t i2c_receive(const uint8_t address, uint8_t *message_buffer,
+                    uint8_t bytes_to_receive);
+
+// clocks SCL until a stuck slave releases SDA (at most 9 times), then stop
+void i2c_recover();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/power.h>
+#include <avr/sleep.h>
+
+#include "power_manager.hpp"
+
+#define POWER_GATED_PERIPHERALS                                                \
+  ((1 << PRTIM1) | (1 << PRTIM0) | (1 << PRUSI) | (1 << PRADC))
+
+void PowerManager::init() {
+  ACSR |= (1 << ACD);
+  apply();
+}
+
+void PowerManager::begin(uint8_t phase) {
+  _phases |= phase;
+  apply();
+}
+
+void PowerManager::end(uint8_t phase) {
+  _phases &= ~phase;
+  apply();
+}
+
+void PowerManager::apply() {
+  uint8_t on = POWER_ALWAYS_ON_PERIPHERALS;
+  if (_phases & POWER_PHASE_MEASURE)
+    on |= POWER_MEASURE_PERIPHERALS;
+  if (_phases & POWER_PHASE_BATTERY)
+    on |= POWER_BATTERY_PERIPHERALS;
+  if (_phases & POWER_PHASE_TRANSMIT)
+    on |= POWER_TRANSMIT_PERIPHERALS;
+  if (_phases & POWER_PHASE_TIMING)
+    on |= POWER_TIMING_PERIPHERALS;
+
+  PRR = POWER_GATED_PERIPHERALS & ~on;
+
+  uint8_t shift =
+      (_phases & POWER_FULL_CLOCK_PHASES) ? 0 : POWER_SLOW_CLOCK_SHIFT;
+  if (shift != _clock_shift) {
+    clock_prescale_set((clock_div_t)shift);
+    _clock_shift = shift;
+  }
+}
+
+void PowerManager::sleep() {
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  cli();
+  sleep_enable();
+#if POWER_SLEEP_BOD_DISABLE && defined(BODS)
+  // BODS only holds for 3 cycles, sei() lets exactly one more instruction
+  // execute before an interrupt
+  sleep_bod_disable();
+#endif
+  sei();
+  sleep_cpu();
+  sleep_disable();
+}
@@ -0,0 +1,79 @@
+#ifndef POWER_MANAGER_HPP
+#define POWER_MANAGER_HPP
+
+#include <stdint.h>
+
+// Clocks only the peripherals the active phases of the loop need, through
+// the power reduction register. Phases may overlap (the pipelined mode
+// measures while it transmits), the union of their peripherals stays on.
+#define POWER_PHASE_MEASURE 0x01  // HDC1080 over I2C
+#define POWER_PHASE_BATTERY 0x02  // battery voltage divider and ADC
+#define POWER_PHASE_TRANSMIT 0x04 // radio frame
+#define POWER_PHASE_TIMING 0x08   // micros(), millis() and delay()
+
+// Peripherals per phase as power reduction register bits. Override them with
+// build flags to measure what gating a peripheral saves.
+#ifndef POWER_MEASURE_PERIPHERALS
+#define POWER_MEASURE_PERIPHERALS (1 << PRUSI)
+#endif
+#ifndef POWER_BATTERY_PERIPHERALS
+#define POWER_BATTERY_PERIPHERALS (1 << PRADC)
+#endif
+#ifndef POWER_TRANSMIT_PERIPHERALS
+#define POWER_TRANSMIT_PERIPHERALS (1 << PRTIM1)
+#endif
+#ifndef POWER_TIMING_PERIPHERALS
+#define POWER_TIMING_PERIPHERALS (1 << PRTIM0)
+#endif
+
+// peripherals that are never gated, e.g. (1 << PRTIM0) to keep millis()
+#ifndef POWER_ALWAYS_ON_PERIPHERALS
+#define POWER_ALWAYS_ON_PERIPHERALS 0
+#endif
+
+// Turn off the brown-out detector during power down. It is only running if
+// the BODLEVEL fuses enable it, the default hfuse 0xDF does not.
+#ifndef POWER_SLEEP_BOD_DISABLE
+#define POWER_SLEEP_BOD_DISABLE 1
+#endif
+
+// The CPU runs at F_CPU >> POWER_SLOW_CLOCK_SHIFT (CLKPR) unless one of the
+// POWER_FULL_CLOCK_PHASES is active. The radio bit timing of Timer1 and
+// micros()/delay() of Timer0 are derived from F_CPU at compile time, so those
+// phases get the full clock. Code running in the other phases has to scale
+// its busy waits with clockShift().
+#ifndef POWER_SLOW_CLOCK_SHIFT
+#define POWER_SLOW_CLOCK_SHIFT 3 // 1 MHz
+#endif
+#ifndef POWER_FULL_CLOCK_PHASES
+#define POWER_FULL_CLOCK_PHASES (POWER_PHASE_TRANSMIT | POWER_PHASE_TIMING)
+#endif
+
+class PowerManager {
+public:
+  PowerManager() : _phases(0), _clock_shift(0) {}
+
+  // Gates every peripheral and slows the clock down, call after they are
+  // configured. Also turns off the analog comparator.
+  void init();
+
+  // The ADC has to be disabled (ADEN cleared) before the battery phase ends.
+  void begin(uint8_t phase);
+  void end(uint8_t phase);
+
+  uint8_t phases() const { return _phases; }
+
+  // the CPU clock is F_CPU >> clockShift()
+  uint8_t clockShift() const { return _clock_shift; }
+
+  // power down until an interrupt (the watchdog) wakes the CPU up
+  void sleep();
+
+private:
+  void apply();
+
+  uint8_t _phases;
+  uint8_t _clock_shift;
+};
+
+#endif
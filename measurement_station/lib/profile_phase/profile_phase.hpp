@@ -0,0 +1,34 @@
+#ifndef PROFILE_PHASE_HPP
+#define PROFILE_PHASE_HPP
+
+#include <stdint.h>
+
+// Loop phase markers for the simavr energy profiler (host/tools/
+// energy_profile.cpp). Built with PROFILE_PHASES the firmware writes the phase
+// it enters to GPIOR0, a single out instruction. The phase only labels what
+// the CPU is busy with, the profiler takes the peripherals that are on from
+// PRR and ADCSRA, the sleep mode from MCUCR and the clock from CLKPR.
+#define PROFILE_PHASE_OTHER 0
+#define PROFILE_PHASE_BATTERY 1
+#define PROFILE_PHASE_MEASURE 2
+#define PROFILE_PHASE_ENCODE 3
+#define PROFILE_PHASE_TRANSMIT 4
+#define PROFILE_PHASE_SLEEP 5
+#define PROFILE_PHASE_COUNT 6
+
+// GPIOR0 in the data address space of the ATtiny25/45/85
+#define PROFILE_PHASE_REGISTER 0x31
+
+#ifdef __AVR__
+#include <avr/io.h>
+
+inline void profilePhase(uint8_t phase) {
+#ifdef PROFILE_PHASES
+  GPIOR0 = phase;
+#else
+  (void)phase;
+#endif
+}
+#endif
+
+#endif
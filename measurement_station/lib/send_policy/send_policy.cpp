@@ -0,0 +1,50 @@
+#include "send_policy.hpp"
+
+static uint16_t distance(uint16_t a, uint16_t b) {
+  return a > b ? a - b : b - a;
+}
+
+// _interval == 0 marks that no sample was seen yet, _since_sent starts at the
+// heartbeat so that the first sample is always sent
+SendPolicy::SendPolicy()
+    : _sent_temperature(0), _sent_humidity(0), _last_temperature(0),
+      _last_humidity(0), _since_sent(SEND_POLICY_HEARTBEAT), _interval(0) {}
+
+bool SendPolicy::update(uint16_t temperature, uint16_t humidity,
+                        uint8_t wakeups) {
+  // adapt the cadence to the slope since the previous sample
+  if (_interval == 0) {
+    _interval = SEND_POLICY_START_INTERVAL;
+  } else {
+    uint16_t temperature_step = distance(temperature, _last_temperature);
+    uint16_t humidity_step = distance(humidity, _last_humidity);
+    if (temperature_step >= SEND_POLICY_TEMPERATURE_DEADBAND ||
+        humidity_step >= SEND_POLICY_HUMIDITY_DEADBAND) {
+      _interval >>= 1;
+      if (_interval < SEND_POLICY_MIN_INTERVAL)
+        _interval = SEND_POLICY_MIN_INTERVAL;
+    } else if (temperature_step < SEND_POLICY_TEMPERATURE_DEADBAND / 4 &&
+               humidity_step < SEND_POLICY_HUMIDITY_DEADBAND / 4 &&
+               _interval < SEND_POLICY_MAX_INTERVAL) {
+      ++_interval;
+    }
+  }
+  _last_temperature = temperature;
+  _last_humidity = humidity;
+
+  // saturates at the heartbeat
+  if (_since_sent < SEND_POLICY_HEARTBEAT)
+    _since_sent += wakeups;
+
+  bool send = _since_sent >= SEND_POLICY_HEARTBEAT ||
+              distance(temperature, _sent_temperature) >=
+                  SEND_POLICY_TEMPERATURE_DEADBAND ||
+              distance(humidity, _sent_humidity) >=
+                  SEND_POLICY_HUMIDITY_DEADBAND;
+  if (send) {
+    _sent_temperature = temperature;
+    _sent_humidity = humidity;
+    _since_sent = 0;
+  }
+  return send;
+}
@@ -0,0 +1,56 @@
+#ifndef SEND_POLICY_HPP
+#define SEND_POLICY_HPP
+
+#include <stdint.h>
+
+// Decides which samples are worth the airtime and how long to sleep until the
+// next one. All values are 14 bit HDC1080 codes (0.01 degC and 0.006 %RH per
+// code) and watchdog wakeups.
+
+// A sample is sent when it moved further than the deadband from the last sent
+// one: ~0.2 degC and ~1 %RH
+#ifndef SEND_POLICY_TEMPERATURE_DEADBAND
+#define SEND_POLICY_TEMPERATURE_DEADBAND 20
+#endif
+#ifndef SEND_POLICY_HUMIDITY_DEADBAND
+#define SEND_POLICY_HUMIDITY_DEADBAND 164
+#endif
+
+// ... or when nothing was sent for this many wakeups (225 * 8s = 30min)
+#ifndef SEND_POLICY_HEARTBEAT
+#define SEND_POLICY_HEARTBEAT 225
+#endif
+
+// Wakeups between samples. The cadence halves when a single interval moves a
+// full deadband and grows by one wakeup while it moves less than a quarter.
+#ifndef SEND_POLICY_MIN_INTERVAL
+#define SEND_POLICY_MIN_INTERVAL 2
+#endif
+#ifndef SEND_POLICY_MAX_INTERVAL
+#define SEND_POLICY_MAX_INTERVAL 14
+#endif
+#ifndef SEND_POLICY_START_INTERVAL
+#define SEND_POLICY_START_INTERVAL 7
+#endif
+
+class SendPolicy {
+public:
+  SendPolicy();
+
+  // Feeds a sample taken wakeups watchdog wakeups after the previous one.
+  // Returns true if it should be transmitted.
+  bool update(uint16_t temperature, uint16_t humidity, uint8_t wakeups);
+
+  // wakeups to sleep until the next sample, valid after the first update()
+  uint8_t interval() const { return _interval; }
+
+private:
+  uint16_t _sent_temperature;
+  uint16_t _sent_humidity;
+  uint16_t _last_temperature;
+  uint16_t _last_humidity;
+  uint16_t _since_sent; // wakeups since the last sent sample
+  uint8_t _interval;
+};
+
+#endif
@@ -0,0 +1,7 @@
+#include "tdma_schedule.hpp"
+
+uint8_t tdmaSlot(uint8_t station_id) { return station_id % TDMA_SLOTS; }
+
+uint16_t tdmaStretchTicks(uint8_t station_id, uint8_t slot_ticks) {
+  return (uint16_t)tdmaSlot(station_id) * slot_ticks;
+}
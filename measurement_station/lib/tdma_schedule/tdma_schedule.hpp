@@ -0,0 +1,54 @@
+#ifndef TDMA_SCHEDULE_HPP
+#define TDMA_SCHEDULE_HPP
+
+#include <stdint.h>
+
+// Per station transmit schedule derived from the station id.
+//
+// The stations only transmit and thus share no time reference, so the slot
+// can not be a fixed phase within a common frame and collisions can not be
+// ruled out. Instead every station stretches each sleep cycle by its slot
+// number times the slot width: while two stations with different slots sleep
+// the same number of wakeups, their periods differ by at least one slot and
+// their relative phase moves by a slot per cycle. With a slot of at least
+// twice the frame airtime they can then never collide on two consecutive
+// frames, a collision is an isolated loss instead of hours without data.
+//
+// That does not hold for stations sharing a slot (ids TDMA_SLOTS apart), whose
+// periods only differ by their clock errors, nor with send on change while the
+// interval of one station is (close to) a multiple of the other's. Those pairs
+// can lose frames in a row, host/tools/tdma_plan simulates both.
+//
+// All times are in watchdog ticks of 16ms, the shortest watchdog timeout. The
+// superframe is the base cycle plus TDMA_SLOTS slots.
+
+// number of distinct slots, stations with id % TDMA_SLOTS equal share a slot
+#ifndef TDMA_SLOTS
+#define TDMA_SLOTS 32
+#endif
+
+#define TDMA_TICK_MS 16
+
+// symbols of a RadioHead ASK frame: 8 symbols preamble and start symbol,
+// then 2 symbols per byte for length, 4 headers, payload and 2 byte CRC
+constexpr uint16_t tdmaFrameSymbols(uint8_t payload_len) {
+  return 8 + 2 * (payload_len + 7);
+}
+
+// airtime of a frame in ms, 6 bits per symbol
+constexpr uint16_t tdmaAirtimeMs(uint8_t payload_len, uint16_t speed) {
+  return ((uint32_t)tdmaFrameSymbols(payload_len) * 6 * 1000 + speed - 1) /
+         speed;
+}
+
+// slot width in ticks: twice the airtime plus one tick of guard
+constexpr uint8_t tdmaSlotTicks(uint16_t airtime_ms) {
+  return (2 * airtime_ms + TDMA_TICK_MS - 1) / TDMA_TICK_MS + 1;
+}
+
+uint8_t tdmaSlot(uint8_t station_id);
+
+// ticks to sleep in addition to the watchdog wakeups of every cycle
+uint16_t tdmaStretchTicks(uint8_t station_id, uint8_t slot_ticks);
+
+#endif
@@ -0,0 +1,152 @@
+# Prints the flash/RAM usage of the firmware after linking and lists the AVR
+# soft float routines that ended up in the image. Building with and without
+# -D HDC1080_NO_FLOAT shows what the float conversions cost.
+#
+# The memory budget breaks flash, .data and .bss down per module (main,
+# RadioHead, the libraries in lib/, Arduino core, toolchain) from the linker
+# map. The build fails if less than custom_ram_headroom bytes of RAM stay free
+# besides .data and .bss. The stack is not part of the check until the
+# energy profiler (host/tools/energy_profile) that measures it in simavr has
+# been validated.
+Import("env")
+
+import glob
+import os
+import re
+import subprocess
+
+# libgcc/libm soft float entry points (add, sub, mul, div, compare, convert)
+SOFT_FLOAT_SYMBOLS = ("__addsf3", "__subsf3", "__mulsf3", "__divsf3",
+                      "__cmpsf2", "__gesf2", "__ltsf2", "__floatunsisf",
+                      "__floatsisf", "__fixsfsi", "__fixunssfsi", "__fp_")
+
+MAP_FILE = "$BUILD_DIR/${PROGNAME}.map"
+env.Append(LINKFLAGS=["-Wl,-Map," + MAP_FILE])
+
+# output sections of the image: .data is copied from flash to RAM at startup
+FLASH_SECTIONS = (".text", ".data")
+RAM_SECTIONS = (".data", ".bss", ".noinit")
+
+OUTPUT_SECTION = re.compile(r"^(\.\w+)(\s+0x[0-9a-f]+\s+0x[0-9a-f]+)?")
+INPUT_SECTION = re.compile(
+    r"^ (\S+)(\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+))?$")
+WRAPPED_INPUT = re.compile(r"^\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+)$")
+
+
+def report_soft_float(nm, elf):
+    float_bytes = 0
+    float_symbols = []
+    symbols = subprocess.check_output([nm, "--size-sort", "-S", elf]).decode()
+    for line in symbols.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[3].startswith(SOFT_FLOAT_SYMBOLS):
+            float_bytes += int(fields[1], 16)
+            float_symbols.append(fields[3])
+
+    if float_symbols:
+        print("soft float: %d bytes in %d routines (%s)" %
+              (float_bytes, len(float_symbols), ", ".join(float_symbols)))
+    else:
+        print("soft float: none linked")
+
+
+def library_objects():
+    # object file name -> library directory in lib/
+    objects = {}
+    for source in glob.glob(env.subst("$PROJECT_DIR/lib/*/*.cpp")):
+        module = os.path.basename(os.path.dirname(source))
+        objects[os.path.basename(source) + ".o"] = module
+    return objects
+
+
+def module_of(path, objects):
+    # archive members look like libfoo.a(bar.cpp.o)
+    member = path.rstrip(")").split("(")[-1]
+    name = os.path.basename(member)
+    if "RadioHead" in path:
+        return "RadioHead"
+    if name in objects:
+        return objects[name]
+    if os.sep + "src" + os.sep in path:
+        return "main"
+    if "FrameworkArduino" in path:
+        return "arduino core"
+    return "toolchain"
+
+
+def parse_map(map_file):
+    # module -> output section -> bytes
+    modules = {}
+    objects = library_objects()
+    output = None
+    pending = None
+    in_memory_map = False
+    with open(map_file) as lines:
+        for line in lines:
+            line = line.rstrip("\n")
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+
+            size = path = None
+            output_match = OUTPUT_SECTION.match(line)
+            input_match = INPUT_SECTION.match(line)
+            wrapped_match = WRAPPED_INPUT.match(line)
+            if output_match:
+                output = output_match.group(1)
+                pending = None
+            elif input_match and input_match.group(2):
+                size, path = input_match.group(3), input_match.group(4)
+            elif input_match:
+                pending = input_match.group(1)  # name too long, sizes follow
+            elif wrapped_match and pending:
+                size, path = wrapped_match.group(1), wrapped_match.group(2)
+                pending = None
+
+            if size and output in FLASH_SECTIONS + RAM_SECTIONS:
+                module = modules.setdefault(module_of(path, objects), {})
+                module[output] = module.get(output, 0) + int(size, 16)
+    return modules
+
+
+def report_budget(map_file):
+    modules = parse_map(map_file)
+    total = {}
+    print("%-16s %6s %6s %6s" % ("module", "flash", ".data", ".bss"))
+    for name in sorted(modules, key=lambda m: -sum(modules[m].values())):
+        sections = modules[name]
+        flash = sum(sections.get(s, 0) for s in FLASH_SECTIONS)
+        bss = sections.get(".bss", 0) + sections.get(".noinit", 0)
+        print("%-16s %6d %6d %6d" %
+              (name, flash, sections.get(".data", 0), bss))
+        for section, size in sections.items():
+            total[section] = total.get(section, 0) + size
+
+    board = env.BoardConfig()
+    ram = int(board.get("upload.maximum_ram_size"))
+    flash = int(board.get("upload.maximum_size"))
+    used_flash = sum(total.get(s, 0) for s in FLASH_SECTIONS)
+    static_ram = sum(total.get(s, 0) for s in RAM_SECTIONS)
+    print("flash: %d of %d bytes" % (used_flash, flash))
+    print("RAM: %d of %d bytes static" % (static_ram, ram))
+
+    free = ram - static_ram
+    headroom = int(env.GetProjectOption("custom_ram_headroom", "0"))
+    print("RAM headroom: %d bytes, %d required" % (free, headroom))
+    if free < headroom:
+        print("RAM headroom below custom_ram_headroom")
+        return 1
+    return 0
+
+
+def report_size(source, target, env):
+    elf = str(source[0])
+    nm = env.subst("$OBJCOPY").replace("objcopy", "nm")
+    size = env.subst("$SIZETOOL")
+
+    print(subprocess.check_output([size, "-A", elf]).decode())
+    report_soft_float(nm, elf)
+    return report_budget(env.subst(MAP_FILE))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report_size)
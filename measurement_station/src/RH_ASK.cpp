@@ -3,10 +3,11 @@
 // Copyright (C) 2014 Mike McCauley
 // $Id: RH_ASK.cpp,v 1.32 2020/08/04 09:02:14 mikem Exp $
 unsigned long int debugVar;
-#include <RHCRC.h>
 #include <RH_ASK.h>
+#include <ask_codec.hpp>
 
-#ifndef __SAMD51__
+// The transmit only build (RH_ASK_TX_ONLY) uses lib/ask_transmitter instead
+#if !defined(__SAMD51__) && !defined(RH_ASK_TX_ONLY)
 
 #if (RH_PLATFORM == RH_PLATFORM_STM32)
 // Maple etc
@@ -557,28 +558,28 @@ bool RH_ASK::send(const uint8_t *data, uint8_t len) {
     return false; // Check channel activity
 
   // Encode the message length
-  crc = RHcrc_ccitt_update(crc, count);
+  crc = askCrcUpdate(crc, count);
   p[index++] = symbols[count >> 4];
   p[index++] = symbols[count & 0xf];
 
   // Encode the headers
-  crc = RHcrc_ccitt_update(crc, _txHeaderTo);
+  crc = askCrcUpdate(crc, _txHeaderTo);
   p[index++] = symbols[_txHeaderTo >> 4];
   p[index++] = symbols[_txHeaderTo & 0xf];
-  crc = RHcrc_ccitt_update(crc, _txHeaderFrom);
+  crc = askCrcUpdate(crc, _txHeaderFrom);
   p[index++] = symbols[_txHeaderFrom >> 4];
   p[index++] = symbols[_txHeaderFrom & 0xf];
-  crc = RHcrc_ccitt_update(crc, _txHeaderId);
+  crc = askCrcUpdate(crc, _txHeaderId);
   p[index++] = symbols[_txHeaderId >> 4];
   p[index++] = symbols[_txHeaderId & 0xf];
-  crc = RHcrc_ccitt_update(crc, _txHeaderFlags);
+  crc = askCrcUpdate(crc, _txHeaderFlags);
   p[index++] = symbols[_txHeaderFlags >> 4];
   p[index++] = symbols[_txHeaderFlags & 0xf];
 
   // Encode the message into 6 bit symbols. Each byte is converted into
   // 2 6-bit symbols, high nybble first, low nybble second
   for (i = 0; i < len; i++) {
-    crc = RHcrc_ccitt_update(crc, data[i]);
+    crc = askCrcUpdate(crc, data[i]);
     p[index++] = symbols[data[i] >> 4];
     p[index++] = symbols[data[i] & 0xf];
   }
@@ -759,19 +760,10 @@ ISR(RH_ATTINY_MEGA_ASK_TIMER_VECTOR) {
 
 // Convert a 6 bit encoded symbol into its 4 bit decoded equivalent
 uint8_t RH_INTERRUPT_ATTR RH_ASK::symbol_6to4(uint8_t symbol) {
-  uint8_t i;
-  uint8_t count;
-
-  // Linear search :-( Could have a 64 byte reverse lookup table?
-  // There is a little speedup here courtesy Ralph Doncaster:
-  // The shortcut works because bit 5 of the symbol is 1 for the last 8
-  // symbols, and it is 0 for the first 8.
-  // So we only have to search half the table
-  for (i = (symbol >> 2) & 8, count = 8; count--; i++)
-    if (symbol == symbols[i])
-      return i;
-
-  return 0; // Not found
+  // 64 byte reverse lookup table of lib/ask_codec, shared with the host
+  // decoders. Not found decodes as 0.
+  uint8_t nybble = askDecodeSymbol(symbol);
+  return nybble == ASK_INVALID_SYMBOL ? 0 : nybble;
 }
 
 // Check whether the latest received message is complete and uncorrupted
@@ -781,7 +773,7 @@ void RH_ASK::validateRxBuf() {
   uint16_t crc = 0xffff;
   // The CRC covers the byte count, headers and user data
   for (uint8_t i = 0; i < _rxBufLen; i++)
-    crc = RHcrc_ccitt_update(crc, _rxBuf[i]);
+    crc = askCrcUpdate(crc, _rxBuf[i]);
   if (crc != 0xf0b8) // CRC when buffer and expected CRC are CRC'd
   {
     // Reject and drop the message
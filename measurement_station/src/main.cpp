@@ -3,26 +3,92 @@
 #include <avr/sleep.h>
 #include <avr/wdt.h>
 
+#include "climate_protocol.hpp"
 #include "hdc1080_driver.hpp"
+#include "power_manager.hpp"
+#include "profile_phase.hpp"
+#include "send_policy.hpp"
+#include "tdma_schedule.hpp"
+#ifdef RH_ASK_TX_ONLY
+#include "ask_transmitter.hpp"
+#else
 #include <RH_ASK.h>
+#endif
 
 #include <EEPROM.h>
 
-// for debugging purposes
+// for debugging purposes: sends the never used stack bytes with format 1, the
+// only stack check until the build can measure it (size_report.py)
 #define USE_STACK_COUNTING 0
 
-// RadioHead bitrate in bit/s
+// payload format sent to the receiver (see climate_protocol.hpp)
+// 1: DataPackage struct with floats (10 bytes)
+// 2: bit-packed raw sensor codes (5 bytes), station id in the FROM header
+// 3: BATCH_SIZE samples delta encoded in one frame, sent every BATCH_SIZE loops
+#define DATA_PACKAGE_FORMAT 2
+
+// samples per frame in format 3, limited by the maximum message length
+#define BATCH_SIZE 4
+
+// Format 2 only: measure the next sample while the current one is being
+// transmitted. The transmitted sample is then one cycle old, but the station is
+// awake only for the transmission instead of conversion + transmission.
+#define PIPELINED_MEASUREMENT 1
+
+// Formats 2 and 3: only send samples that moved beyond a deadband (or when the
+// heartbeat expires) and adapt the sampling cadence to the slope, see
+// send_policy.hpp. Without it every sample is sent every
+// WATCHDOG_WAKEUPS_TARGET wakeups.
+#define SEND_ON_CHANGE 1
+
+// Stretch every sleep cycle by a slot derived from the station id so that no
+// two stations keep colliding, see tdma_schedule.hpp
+#define TDMA_SCHEDULE 1
+
+// Measure the watchdog timeout against the system clock every
+// WATCHDOG_CALIBRATION_INTERVAL loops and sleep in calibrated watchdog ticks.
+// The watchdog oscillator drifts by up to 10% with voltage and temperature,
+// the factory calibrated RC oscillator by about 1% around room temperature.
+#define WATCHDOG_CALIBRATION 1
+#define WATCHDOG_CALIBRATION_INTERVAL 16
+
+// RadioHead bitrate in bit/s, the receiver has to use the same. With
+// RH_ASK_TX_ONLY 2000, 4000, 8000 and 9600 are validated, higher rates cut
+// the airtime but need a receiver with clean edges (see link_sim -S).
+#ifndef RH_SPEED
 #define RH_SPEED 2000
+#endif
+#if !defined(RH_ASK_TX_ONLY) && RH_SPEED > 2000
+#error RH_ASK interrupts 8 times per bit, use RH_ASK_TX_ONLY above 2000 bit/s
+#endif
 
 // pins for the radio hardware
 #define RH_RX_PIN 10  // not used, set to a non-existens pin
 #define RH_TX_PIN PB1 // Transmit pin
 #define RH_PTT_PIN 10 // not used, set to a non-existens pin
 
+// Measure the supply voltage against the internal 1.1V bandgap instead of the
+// battery through the voltage divider on PB3/PB4. Needs the battery to supply
+// Vcc directly. Formats 2 and 3 then report the voltage in mV.
+#define BATTERY_SENSE_BANDGAP 1
+
 // min max values for the ADC to calculate the battery percent
 #define ADC_MIN 600 // ~1.5V (3*1V/2)
 #define ADC_MAX 840 // ~2.1V (3*1.4V/2)
 
+// min max supply voltage to calculate the battery percent with the bandgap
+#define BATTERY_MV_MIN 3000 // 3*1V
+#define BATTERY_MV_MAX 4200 // 3*1.4V
+
+// The bandgap is 1.1V +-0.1V, put the value measured on a chip here for
+// absolute accuracy
+#define BANDGAP_MV 1100
+
+// Conversions averaged per battery reading, 16 add 2 bits of resolution. The
+// first conversions after switching to the bandgap are discarded.
+#define BATTERY_OVERSAMPLING 16
+#define BATTERY_SETTLE_CONVERSIONS 8
+
 // time until the watchdog wakes the mc in seconds
 #define WATCHDOG_TIME 8 // 1, 2, 4 or 8
 
@@ -30,11 +96,35 @@
 #define WATCHDOG_WAKEUPS_TARGET                                                \
   7 // 8 * 7 = 56 seconds between each data collection
 
+// HDC1080 resolution, lower resolutions convert faster
+#define HDC1080_TEMPERATURE_RESOLUTION                                         \
+  HDC1080_CONFIG_TEMPERATURE_RESOLUTION_14BIT
+#define HDC1080_HUMIDITY_RESOLUTION HDC1080_CONFIG_HUMIDITY_RESOLUTION_14BIT
+
 // after how many loops the battery level should be refreshed
 #define BATTERY_LEVEL_UPDATE_THRESHOLD 1
 
+#ifdef RH_ASK_TX_ONLY
+AskTransmitter<RH_SPEED, RH_TX_PIN> rh_driver;
+ASK_TRANSMITTER_ISR(rh_driver)
+#define RH_MAX_MESSAGE_LEN ASK_TX_MAX_MESSAGE_LEN
+#else
 RH_ASK rh_driver(RH_SPEED, RH_RX_PIN, RH_TX_PIN, RH_PTT_PIN);
-HDC1080I2CDriver hdc1080;
+#define RH_MAX_MESSAGE_LEN RH_ASK_MAX_MESSAGE_LEN
+#endif
+#if DATA_PACKAGE_FORMAT == 1
+#define RADIO_PAYLOAD_LEN (10 + USE_STACK_COUNTING)
+#elif DATA_PACKAGE_FORMAT == 2
+#define RADIO_PAYLOAD_LEN CLIMATE_V2_PAYLOAD_LEN
+#else
+#define RADIO_PAYLOAD_LEN CLIMATE_BATCH_MAX_LEN(BATCH_SIZE)
+#endif
+#define TDMA_SLOT_TICKS                                                        \
+  tdmaSlotTicks(tdmaAirtimeMs(RADIO_PAYLOAD_LEN, RH_SPEED))
+
+HDC1080I2CDriver hdc1080(HDC1080_TEMPERATURE_RESOLUTION,
+                         HDC1080_HUMIDITY_RESOLUTION);
+PowerManager power;
 
 #if USE_STACK_COUNTING
 extern uint8_t _end;
@@ -82,10 +172,20 @@ uint16_t availableStackSize() {
 }
 #endif
 
+// ADC clock prescaler 64 at the full clock: 8E6/64 < 200 kHz
+#define ADC_PRESCALER_SHIFT 6
+static_assert(POWER_SLOW_CLOCK_SHIFT < ADC_PRESCALER_SHIFT,
+              "no ADC prescaler for this clock");
+
 void setupADC() {
+#if BATTERY_SENSE_BANDGAP
+  ADMUX = (1 << MUX3) | // select the 1.1V bandgap as input
+          (1 << MUX2);  // against Vcc as reference
+#else
   ADMUX = (1 << REFS2) | // select internal 2.56V Aref
           (1 << REFS1) | // select internal 2.56V Aref
           (1 << MUX1);   // select ADC2 (PB4)
+#endif
 
   ADCSRA = (1 << ADEN) |  // enable ADC
            (1 << ADPS2) | // set ADC prescalar to 64 that 8E6/64 < 200 kHz
@@ -93,31 +193,50 @@ void setupADC() {
 
   ADCSRA &= ~(1 << ADEN); // disable ADC for powersaving
 
-  // disable analog comperator for powersaving
-  ACSR |= (1 << ACD);
+  // no digital input buffer on the analog battery pin
+  DIDR0 |= (1 << ADC2D);
 }
 
-void enableWatchdog() {
+// watchdog prescaler bits for the WATCHDOG_TIME timeout
+#if WATCHDOG_TIME == 1
+#define WATCHDOG_PRESCALER (1 << WDP1 | 1 << WDP2)
+#elif WATCHDOG_TIME == 2
+#define WATCHDOG_PRESCALER (1 << WDP0 | 1 << WDP1 | 1 << WDP2)
+#elif WATCHDOG_TIME == 4
+#define WATCHDOG_PRESCALER (1 << WDP3)
+#elif WATCHDOG_TIME == 8
+#define WATCHDOG_PRESCALER (1 << WDP0 | 1 << WDP3)
+#else
+#error WATCHDOG_TIME must be 1, 2, 4 or 8!
+#endif
+
+// shortest watchdog timeout (16ms), used to sleep through the HDC1080
+// conversion
+#define WATCHDOG_PRESCALER_16MS 0
+
+// watchdog ticks (16ms timeouts) in one WATCHDOG_TIME timeout
+#define WATCHDOG_TICKS (WATCHDOG_TIME * 64)
+
+// duration of a 16ms watchdog timeout in us, measured by calibrateWatchdog()
+uint16_t watchdog_tick_us = CLIMATE_WATCHDOG_TICK_US;
+
+volatile bool watchdog_fired;
+volatile unsigned long watchdog_fired_us;
+
+void enableWatchdog(uint8_t prescaler) {
   cli();
 
+  // restart the timeout from zero
+  wdt_reset();
+
   // clear the reset flag
   MCUSR &= ~(1 << WDRF);
 
   // set WDCE to be able to change/set WDE
   WDTCR |= (1 << WDCE) | (1 << WDE);
 
-// set new watchdog timeout prescaler value
-#if WATCHDOG_TIME == 1
-  WDTCR = 1 << WDP1 | 1 << WDP2;
-#elif WATCHDOG_TIME == 2
-  WDTCR = 1 << WDP0 | 1 << WDP1 | 1 << WDP2;
-#elif WATCHDOG_TIME == 4
-  WDTCR = 1 << WDP3;
-#elif WATCHDOG_TIME == 8
-  WDTCR = 1 << WDP0 | 1 << WDP3;
-#else
-#error WATCHDOG_TIME must be 1, 2, 4 or 8!
-#endif
+  // set new watchdog timeout prescaler value
+  WDTCR = prescaler;
 
   // enable the WD interrupt to get an interrupt instead of a reset
   WDTCR |= (1 << WDIE);
@@ -126,25 +245,159 @@ void enableWatchdog() {
 }
 
 void enterSleep(void) {
-  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
-  sleep_enable();
+  // power down (with the brown-out detector off) until the WDT timeout
+  power.sleep();
+}
 
-  // Now enter sleep mode
-  sleep_mode();
+// watchdog prescaler bits for a timeout of 2^n * 16ms, n = 0..9
+uint8_t watchdogPrescaler(uint8_t n) {
+  return (n & 7) | ((n & 8) ? (1 << WDP3) : 0);
+}
 
-  // The program will continue from here after the WDT timeout
-  // First thing to do is disable sleep
-  sleep_disable();
+// Power down sleep for ticks * 16ms, one watchdog timeout per set bit
+void sleepTicks(uint16_t ticks) {
+  if (!ticks) {
+    return;
+  }
+  for (int8_t n = 9; n >= 0; n--) {
+    while (ticks >= (1 << n)) {
+      enableWatchdog(watchdogPrescaler(n));
+      enterSleep();
+      ticks -= 1 << n;
+    }
+  }
+  enableWatchdog(WATCHDOG_PRESCALER);
 }
 
-uint8_t batteryLevel() {
+// Power down sleep for ms, counted in calibrated watchdog ticks. The first
+// WATCHDOG_TIME timeout is already running and covers most of the time spent
+// awake.
+void sleepMs(uint32_t ms) {
+  uint32_t ticks = (ms * 1000 + watchdog_tick_us / 2) / watchdog_tick_us;
+  for (; ticks >= WATCHDOG_TICKS; ticks -= WATCHDOG_TICKS) {
+    enterSleep();
+  }
+  sleepTicks(ticks);
+}
+
+#if WATCHDOG_CALIBRATION
+unsigned long watchdog_calibration_start_us;
+bool calibrate_watchdog;
+bool watchdog_calibrated = false;
+
+// Starts a 16ms watchdog timeout to be timed with micros(). Timer 0 has to
+// keep running until finishWatchdogCalibration(), so awake or idle sleep only.
+void startWatchdogCalibration() {
+  power.begin(POWER_PHASE_TIMING);
+  enableWatchdog(WATCHDOG_PRESCALER_16MS);
+  // cleared after the restart, so no timeout of the previous prescaler ends
+  // the calibration
+  watchdog_fired = false;
+  watchdog_calibration_start_us = micros();
+}
+
+// A 16ms tick measured outside of +-50% of the nominal one went wrong (the
+// oscillator tolerance is 10%), the last calibration is kept then.
+#define WATCHDOG_TICK_MIN_US (CLIMATE_WATCHDOG_TICK_US / 2)
+#define WATCHDOG_TICK_MAX_US (CLIMATE_WATCHDOG_TICK_US * 3 / 2)
+
+void finishWatchdogCalibration() {
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (!watchdog_fired) {
+    sleep_mode();
+  }
+  // the first timeout, the ISR latches it while the caller may have slept
+  // through several in waitPacketSent()
+  unsigned long tick_us = watchdog_fired_us - watchdog_calibration_start_us;
+  enableWatchdog(WATCHDOG_PRESCALER);
+  power.end(POWER_PHASE_TIMING);
+  calibrate_watchdog = false;
+  if (tick_us < WATCHDOG_TICK_MIN_US || tick_us > WATCHDOG_TICK_MAX_US) {
+    return;
+  }
+
+  // first measurement as is, then a moving average against the jitter
+  if (!watchdog_calibrated) {
+    watchdog_tick_us = tick_us;
+    watchdog_calibrated = true;
+  } else {
+    watchdog_tick_us = ((uint32_t)watchdog_tick_us * 3 + tick_us + 2) / 4;
+  }
+  rh_driver.setHeaderId(climatePackDrift(watchdog_tick_us));
+}
+#endif
+
+#if BATTERY_SENSE_BANDGAP
+void batteryStart() {
+  profilePhase(PROFILE_PHASE_BATTERY);
+  power.begin(POWER_PHASE_BATTERY);
+  ADCSRA |= (1 << ADEN); // enable the ADC
+}
+
+// Vcc in mV from the bandgap conversions, each done in ADC noise reduction
+// sleep instead of polling ADSC
+uint16_t batteryMillivolts() {
+  ADCSRA |= (1 << ADIE);
+  set_sleep_mode(SLEEP_MODE_ADC);
+
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < BATTERY_SETTLE_CONVERSIONS + BATTERY_OVERSAMPLING;
+       i++) {
+    sleep_mode(); // entering the sleep mode starts the conversion
+    while (ADCSRA & (1 << ADSC))
+      ; // woken up by another interrupt
+    if (i >= BATTERY_SETTLE_CONVERSIONS) {
+      sum += ADC;
+    }
+  }
+  ADCSRA &= ~(1 << ADIE);
+
+  // ADC = Vbg * 1024 / Vcc
+  return (uint32_t)BANDGAP_MV * 1024 * BATTERY_OVERSAMPLING / sum;
+}
+
+uint8_t batteryFinish() {
+  profilePhase(PROFILE_PHASE_BATTERY);
+  // keep the ADC clock at ~125 kHz for the current CPU clock
+  ADCSRA = (ADCSRA & ~((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))) |
+           (ADC_PRESCALER_SHIFT - power.clockShift());
+  uint16_t millivolts = batteryMillivolts();
+
+  // disable the ADC (power saving during power off state)
+  ADCSRA &= ~(1 << ADEN);
+  power.end(POWER_PHASE_BATTERY);
+
+#if DATA_PACKAGE_FORMAT == 1
+  if (millivolts >= BATTERY_MV_MAX) {
+    return 100;
+  } else if (millivolts <= BATTERY_MV_MIN) {
+    return 0;
+  }
+  return (uint32_t)100 * (millivolts - BATTERY_MV_MIN) /
+         (BATTERY_MV_MAX - BATTERY_MV_MIN);
+#else
+  return climateBatteryVoltage(millivolts);
+#endif
+}
+
+EMPTY_INTERRUPT(ADC_vect)
+#else
+void batteryStart() {
   // In order to have a low power battery measurement, a pin of the attiny (here
   // pin3/PB3) is used to output the battery voltage and serves as a on off
   // switch of the current through the voltage divider. turn on PB3
+  profilePhase(PROFILE_PHASE_BATTERY);
   digitalWrite(PB3, HIGH);
+  power.begin(POWER_PHASE_BATTERY);
   ADCSRA |= (1 << ADEN); // enable the ADC
-  delay(10);
+}
 
+// needs the divider to have settled for 10ms after batteryStart()
+uint8_t batteryFinish() {
+  profilePhase(PROFILE_PHASE_BATTERY);
+  // keep the ADC clock at ~125 kHz for the current CPU clock
+  ADCSRA = (ADCSRA & ~((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))) |
+           (ADC_PRESCALER_SHIFT - power.clockShift());
   ADCSRA |= (1 << ADSC); // start ADC measurement
   while (ADCSRA & (1 << ADSC))
     ; // wait till conversion complete
@@ -153,6 +406,7 @@ uint8_t batteryLevel() {
 
   // disable the ADC (power saving during power off state)
   ADCSRA &= ~(1 << ADEN);
+  power.end(POWER_PHASE_BATTERY);
   digitalWrite(PB3, LOW); // turn off pin3
 
   uint8_t battery_percentage = (100 * (adc - ADC_MIN)) / (ADC_MAX - ADC_MIN);
@@ -163,7 +417,66 @@ uint8_t batteryLevel() {
   }
   return battery_percentage;
 }
+
+#endif
+
+uint8_t batteryLevel() {
+  batteryStart();
+#if !BATTERY_SENSE_BANDGAP
+  // busy wait at the slow clock, delayMicroseconds() counts F_CPU cycles
+  delayMicroseconds(10000 >> power.clockShift());
+#endif
+  return batteryFinish();
+}
+
+void sleepThroughConversion() {
+  profilePhase(PROFILE_PHASE_MEASURE);
+#if WATCHDOG_CALIBRATION
+  if (calibrate_watchdog) {
+    // the 16ms timeout covers the conversion as well, just in idle sleep
+    startWatchdogCalibration();
+    finishWatchdogCalibration();
+    return;
+  }
+#endif
+  // The longest conversion (14 bit + 14 bit) takes 12.85ms, which is still
+  // shorter than the 16ms watchdog timeout with its 10% tolerance. So sleep in
+  // power down instead of waiting with the CPU running.
+  enableWatchdog(WATCHDOG_PRESCALER_16MS);
+  enterSleep();
+  enableWatchdog(WATCHDOG_PRESCALER);
+}
+
+// The USI is only clocked for the I2C transfers, not during the conversion.
+// All three return false if the sensor did not answer (the I2C functions
+// already recovered a stuck bus), the sample is skipped then.
+bool startClimate() {
+  profilePhase(PROFILE_PHASE_MEASURE);
+  power.begin(POWER_PHASE_MEASURE);
+  bool started = hdc1080.startMeasurement();
+  power.end(POWER_PHASE_MEASURE);
+  return started;
+}
+
+bool readClimate(ClimateDataRaw *raw) {
+  profilePhase(PROFILE_PHASE_MEASURE);
+  power.begin(POWER_PHASE_MEASURE);
+  bool read = hdc1080.readMeasurement(raw);
+  power.end(POWER_PHASE_MEASURE);
+  return read;
+}
+
+bool measureClimate(ClimateDataRaw *raw) {
+  if (!startClimate()) {
+    return false;
+  }
+  sleepThroughConversion();
+  return readClimate(raw);
+}
 uint8_t id;
+#if TDMA_SCHEDULE
+uint16_t tdma_stretch_ticks;
+#endif
 
 void setup() {
   hdc1080.init();
@@ -175,11 +488,18 @@ void setup() {
   // use PB3 pin as a voltage source for the battery measurement
   pinMode(PB3, OUTPUT);
   setupADC();
-  enableWatchdog();
+  enableWatchdog(WATCHDOG_PRESCALER);
   id = eeprom_read_byte((uint8_t*)0); // EEprom read address 0
+  rh_driver.setHeaderFrom(id);
+#if TDMA_SCHEDULE
+  tdma_stretch_ticks = tdmaStretchTicks(id, TDMA_SLOT_TICKS);
+#endif
 
+  // everything is configured, from now on the loop phases clock what they need
+  power.init();
 }
 
+#if DATA_PACKAGE_FORMAT == 1
 struct DataPackage {
   ClimateData climate_data;
   uint8_t battery_level;
@@ -188,36 +508,231 @@ struct DataPackage {
   uint8_t available_stack_size;
 #endif
 };
+#endif
 
 uint8_t battery_level;
 uint8_t loop_counter = 0;
+#if WATCHDOG_CALIBRATION
+uint8_t calibration_counter = 0;
+#endif
+
+#if DATA_PACKAGE_FORMAT == 2
+bool sendClimate(const ClimateDataRaw &raw) {
+  profilePhase(PROFILE_PHASE_ENCODE);
+  ClimateSample sample;
+  sample.temperature = raw.temperature >> 2; // low 2 bits are always zero
+  sample.humidity = raw.humidity >> 2;
+  sample.battery = battery_level;
+
+  uint8_t payload[CLIMATE_V2_PAYLOAD_LEN];
+  power.begin(POWER_PHASE_TRANSMIT);
+  return rh_driver.send(payload, climatePackV2(sample, payload));
+}
+#endif
+
+#if DATA_PACKAGE_FORMAT == 3
+static_assert(BATCH_SIZE >= 1 && BATCH_SIZE <= CLIMATE_BATCH_MAX_SAMPLES &&
+                  CLIMATE_BATCH_MAX_LEN(BATCH_SIZE) <= RH_MAX_MESSAGE_LEN,
+              "BATCH_SIZE samples do not fit into one frame");
+
+ClimateBatchSample batch[BATCH_SIZE];
+uint8_t batch_count = 0;
+
+// sleep time since the last batched sample in ms, TDMA stretch included, goes
+// into the offsets
+int32_t ms_since_batched = 0;
+
+void addToBatch(const ClimateDataRaw &raw) {
+  ClimateBatchSample &sample = batch[batch_count++];
+  sample.temperature = raw.temperature >> 2; // low 2 bits are always zero
+  sample.humidity = raw.humidity >> 2;
+  sample.offset =
+      climateBatchOffset(&ms_since_batched, (uint16_t)WATCHDOG_TIME * 1000);
+}
+
+bool sendBatch() {
+  profilePhase(PROFILE_PHASE_ENCODE);
+  uint8_t payload[CLIMATE_BATCH_MAX_LEN(BATCH_SIZE)];
+  uint8_t len = climatePackBatch(batch, batch_count, battery_level, payload);
+  batch_count = 0;
+  power.begin(POWER_PHASE_TRANSMIT);
+  return rh_driver.send(payload, len);
+}
+#endif
+
+// watchdog wakeups since the last sample
+uint8_t wakeups_since_sample = 0;
+
+#if SEND_ON_CHANGE
+#if DATA_PACKAGE_FORMAT == 1
+#error SEND_ON_CHANGE needs DATA_PACKAGE_FORMAT 2 or 3!
+#endif
+#if DATA_PACKAGE_FORMAT == 3
+static_assert(SEND_POLICY_HEARTBEAT + SEND_POLICY_MAX_INTERVAL <= 256,
+              "batch offsets can not hold the heartbeat interval");
+#endif
+SendPolicy send_policy;
+#endif
+
+bool shouldSend(const ClimateDataRaw &raw) {
+#if SEND_ON_CHANGE
+  return send_policy.update(raw.temperature >> 2, raw.humidity >> 2,
+                            wakeups_since_sample);
+#else
+  return true;
+#endif
+}
+
+uint8_t sleepWakeups() {
+#if SEND_ON_CHANGE
+  return send_policy.interval();
+#else
+  return WATCHDOG_WAKEUPS_TARGET;
+#endif
+}
+
+#if PIPELINED_MEASUREMENT
+#if DATA_PACKAGE_FORMAT != 2
+#error PIPELINED_MEASUREMENT needs DATA_PACKAGE_FORMAT 2!
+#endif
+// sample that goes out with the next transmission, next_climate_send is false
+// if it could not be read
+ClimateDataRaw next_climate;
+bool next_climate_valid = false;
+bool next_climate_send;
+#endif
 
 void loop() {
-  if (loop_counter % BATTERY_LEVEL_UPDATE_THRESHOLD == 0) {
-    battery_level = batteryLevel();
+  profilePhase(PROFILE_PHASE_OTHER);
+  bool update_battery = loop_counter % BATTERY_LEVEL_UPDATE_THRESHOLD == 0;
+  if (update_battery) {
     loop_counter = 0;
   }
   ++loop_counter;
+#if WATCHDOG_CALIBRATION
+  if (calibration_counter++ % WATCHDOG_CALIBRATION_INTERVAL == 0) {
+    calibration_counter = 1;
+    calibrate_watchdog = true;
+  }
+#endif
 
+#if PIPELINED_MEASUREMENT
+  if (!next_climate_valid) {
+    // nothing measured yet after power up, do it sequentially once
+    battery_level = batteryLevel();
+    next_climate_send =
+        measureClimate(&next_climate) && shouldSend(next_climate);
+    next_climate_valid = true;
+    update_battery = false;
+  }
+
+  bool measured;
+  if (next_climate_send) {
+    bool sending = sendClimate(next_climate);
+
+    // Convert the next sample (and let the battery divider settle) while the
+    // timer interrupt clocks out the frame. A frame takes ~100ms, much longer
+    // than the conversion and the 10ms divider settling time.
+    bool started = startClimate();
+    if (update_battery) {
+      batteryStart();
+    }
+    if (sending) {
+      profilePhase(PROFILE_PHASE_TRANSMIT);
+#if WATCHDOG_CALIBRATION
+      if (calibrate_watchdog) {
+        startWatchdogCalibration();
+      }
+#endif
+      rh_driver.waitPacketSent();
+#if WATCHDOG_CALIBRATION
+      if (calibrate_watchdog) {
+        finishWatchdogCalibration();
+      }
+#endif
+    } else {
+      sleepThroughConversion();
+    }
+    power.end(POWER_PHASE_TRANSMIT);
+    if (update_battery) {
+      battery_level = batteryFinish();
+    }
+    measured = started && readClimate(&next_climate);
+  } else {
+    // nothing to send, measure the way the other modes do
+    if (update_battery) {
+      battery_level = batteryLevel();
+    }
+    measured = measureClimate(&next_climate);
+  }
+  next_climate_send = measured && shouldSend(next_climate);
+#else
+  if (update_battery) {
+    battery_level = batteryLevel();
+  }
+
+#if DATA_PACKAGE_FORMAT == 1
+#ifdef HDC1080_NO_FLOAT
+#error DATA_PACKAGE_FORMAT 1 needs floats, remove HDC1080_NO_FLOAT!
+#endif
   DataPackage data;
-  data.climate_data = hdc1080.measure();
-  data.battery_level = battery_level;
-  data.station_id = id; // read from EEprom
+  // measure() waits for the conversion with micros()
+  profilePhase(PROFILE_PHASE_MEASURE);
+  power.begin(POWER_PHASE_MEASURE | POWER_PHASE_TIMING);
+  bool measured = hdc1080.measure(&data.climate_data);
+  power.end(POWER_PHASE_MEASURE | POWER_PHASE_TIMING);
+  if (measured) {
+    data.battery_level = battery_level;
+    data.station_id = id; // read from EEprom
 #if USE_STACK_COUNTING
-  data.available_stack_size = (uint8_t)availableStackSize();
+    data.available_stack_size = (uint8_t)availableStackSize();
 #endif
 
-  rh_driver.send((uint8_t *)&data, sizeof(data));
+    profilePhase(PROFILE_PHASE_ENCODE);
+    power.begin(POWER_PHASE_TRANSMIT);
+    rh_driver.send((uint8_t *)&data, sizeof(data));
+  }
+#elif DATA_PACKAGE_FORMAT == 2
+  ClimateDataRaw climate;
+  if (measureClimate(&climate) && shouldSend(climate)) {
+    sendClimate(climate);
+  }
+#elif DATA_PACKAGE_FORMAT == 3
+  ClimateDataRaw climate;
+  if (measureClimate(&climate) && shouldSend(climate)) {
+    addToBatch(climate);
+  }
+  if (batch_count == BATCH_SIZE) {
+    sendBatch();
+  }
+#else
+#error DATA_PACKAGE_FORMAT must be 1, 2 or 3!
+#endif
+  profilePhase(PROFILE_PHASE_TRANSMIT);
   rh_driver.waitPacketSent();
+  power.end(POWER_PHASE_TRANSMIT);
+#endif
 
   // deep sleep
-  for (uint8_t i = 0; i < WATCHDOG_WAKEUPS_TARGET; i++) {
-    // hdc1080.measure(); // dummy measure to make better measurements
-    enterSleep();
-  }
+  profilePhase(PROFILE_PHASE_SLEEP);
+  uint8_t wakeups = sleepWakeups();
+  uint32_t sleep_ms = (uint32_t)wakeups * WATCHDOG_TIME * 1000;
+#if TDMA_SCHEDULE
+  sleep_ms += tdma_stretch_ticks * TDMA_TICK_MS;
+#endif
+  sleepMs(sleep_ms);
+  wakeups_since_sample = wakeups;
+#if DATA_PACKAGE_FORMAT == 3
+  ms_since_batched += sleep_ms;
+#endif
 }
 
 // watchdog ISR
 ISR(WDT_vect) {
   WDTCR |= (1 << WDIE); // just wake up here and reset the interrupt bit again
+  // keep the time of the first timeout for finishWatchdogCalibration()
+  if (!watchdog_fired) {
+    watchdog_fired_us = micros();
+    watchdog_fired = true;
+  }
 }